@@ -0,0 +1,243 @@
+#include "./func.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <limits>
+
+// Heuristic desirability of each Steiner point method for the obtuse face of edge, from the
+// ratio rho = circumradius / height onto the longest edge: projections suit slightly obtuse
+// faces, circumcenters very obtuse ones, midpoints faces close to right angled, the mean point
+// needs obtuse neighbours
+static void steiner_heuristic(const CDT &cdt, const CDT::Edge &edge, double eta[5])
+{
+    const Point_2 &p1 = edge.first->vertex((edge.second + 1) % 3)->point();
+    const Point_2 &p2 = edge.first->vertex((edge.second + 2) % 3)->point();
+    const Point_2 &obtuse = edge.first->vertex(edge.second)->point();
+
+    double longest = std::sqrt(CGAL::to_double(CGAL::squared_distance(p1, p2)));
+    Kernel::Vector_2 u = p2 - p1, v = obtuse - p1;
+    double double_area = std::abs(CGAL::to_double(u.x() * v.y() - u.y() * v.x()));
+    double radius = std::sqrt(CGAL::to_double(CGAL::squared_distance(CGAL::circumcenter(p1, p2, obtuse), p1)));
+    double rho = double_area > 0 ? radius / (double_area / longest) : 0; // height = 2 * area / longest
+
+    int obtuse_neighbours = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        CDT::Face_handle neighbour = edge.first->neighbor(i);
+        if (!cdt.is_infinite(neighbour) &&
+            obtuse_vertex(neighbour->vertex(0)->point(), neighbour->vertex(1)->point(), neighbour->vertex(2)->point()) >= 0)
+            obtuse_neighbours++;
+    }
+
+    eta[0] = rho / (2 + rho);                              // Circumcenter
+    eta[1] = std::max(0.0, (3 - 2 * rho) / 3);             // Midpoint
+    eta[2] = rho > 0 ? std::max(0.0, (rho - 1) / rho) : 0; // Projection
+    eta[3] = 0.5;                                          // Centroid, left to its pheromone
+    eta[4] = obtuse_neighbours >= 2 ? 1 : 0;               // Mean point
+}
+
+// Cell of the coarse grid the pheromones are kept on
+int pheromone_table::region_of(const Point_2 &point) const
+{
+    int cx = (int)((CGAL::to_double(point.x()) - min_x) / (max_x - min_x) * regions);
+    int cy = (int)((CGAL::to_double(point.y()) - min_y) / (max_y - min_y) * regions);
+    cx = std::max(0, std::min(regions - 1, cx));
+    cy = std::max(0, std::min(regions - 1, cy));
+    return cy * regions + cx;
+}
+
+void pheromone_table::reset(const CDT &cdt, int regions_per_axis)
+{
+    regions = regions_per_axis;
+    min_x = min_y = std::numeric_limits<double>::max();
+    max_x = max_y = std::numeric_limits<double>::lowest();
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        min_x = std::min(min_x, CGAL::to_double(vit->point().x()));
+        max_x = std::max(max_x, CGAL::to_double(vit->point().x()));
+        min_y = std::min(min_y, CGAL::to_double(vit->point().y()));
+        max_y = std::max(max_y, CGAL::to_double(vit->point().y()));
+    }
+    if (max_x <= min_x)
+        max_x = min_x + 1;
+    if (max_y <= min_y)
+        max_y = min_y + 1;
+    tau.assign(regions * regions, std::array<double, 5>{1, 1, 1, 1, 1});
+}
+
+// One ant: up to moves insertions on its own mesh (a replica of the colony's), every method drawn with
+// probability proportional to tau^xi * eta^psi. The ant stops early at the deadline or when the run
+// is cancelled (control is the run's, the pool thread has none), its mesh so far is still scored.
+// The insertions are rolled back at the end, the ant keeps only their points and its energy.
+static void run_ant(int start_steiner, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region,
+                    const pheromone_table &pheromones, double alpha, double beta, double xi, double psi, int moves, unsigned seed,
+                    std::chrono::steady_clock::time_point deadline, const run_control *control, ant_result &ant)
+{
+    ant.steiner_points = start_steiner;
+    ant.choices.clear();
+    ant.points.clear();
+    std::mt19937 gen(seed);
+    cdt_transaction trial(ant.cdt, &ant.score);
+    trial.begin();
+
+    obtuse_sampler obtuse_faces;
+    obtuse_faces.push_all_faces(ant.cdt);
+    for (int m = 0; m < moves && !should_stop(deadline, control); m++)
+    {
+        CDT::Face_handle face;
+        int obtuse_index;
+        if (!obtuse_faces.sample(ant.cdt, gen, face, obtuse_index))
+            break;
+        CDT::Edge edge(face, obtuse_index);
+
+        double eta[5], weight[5], total = 0;
+        steiner_heuristic(ant.cdt, edge, eta);
+        int cell = pheromones.region_of(CGAL::centroid(face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point()));
+        for (int i = 0; i < 5; i++)
+        {
+            weight[i] = std::pow(pheromones.tau[cell][i], xi) * std::pow(eta[i], psi);
+            total += weight[i];
+        }
+        int method = total > 0 ? std::discrete_distribution<int>(weight, weight + 5)(gen)
+                               : std::uniform_int_distribution<int>(0, 4)(gen);
+
+        Point_2 point = get_steiner_point(ant.cdt, edge, constraints, method);
+        if (!region.contains(point) || point_exists_in_cdt(point, ant.cdt))
+            continue;
+
+        CDT::Vertex_handle vertex = trial.insert(point);
+        if (vertex == CDT::Vertex_handle())
+            continue;
+        ant.steiner_points++;
+        ant.choices.push_back({cell, method});
+        ant.points.push_back(point);
+        obtuse_faces.push_incident_faces(ant.cdt, vertex);
+    }
+    ant.energy = alpha * ant.score.no_obtuse_faces + beta * ant.steiner_points;
+    trial.rollback();
+}
+
+// Insert the points of a winning ant into mesh, with its score kept in sync
+static void replay(CDT &cdt, mesh_score &score, const vector<Point_2> &points)
+{
+    for (const auto &point : points)
+        insert_and_score(cdt, score, point);
+}
+
+// Ant colony optimization over Steiner insertions (parameters_ant: alpha, beta, xi, psi, lambda, kappa, L).
+// Every cycle kappa ants start from the best mesh so far, each on its own thread and its own replica of
+// that mesh. The replicas are copied once; an ant undoes its moves after the cycle, and the points of
+// the winning ant are inserted into the colony's mesh and every replica.
+// The pheromones are merged after the cycle in ant order, so the result does not depend on thread timing.
+void ant_colony(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                ptree parameters, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint)
+{
+    double alpha = parameters.get<double>("alpha", 2.0);
+    double beta = parameters.get<double>("beta", 0.2);
+    double xi = parameters.get<double>("xi", 1.0);
+    double psi = parameters.get<double>("psi", 3.0);
+    double lambda = parameters.get<double>("lambda", 0.5);
+    int kappa = parameters.get<int>("kappa", 10);
+    int L = parameters.get<int>("L", 50);
+    int moves = parameters.get<int>("moves", 10);
+    unsigned seed = parameters.get<unsigned>("seed", 1);
+    int threads = thread_parameter(parameters, "threads");
+
+    pheromone_table pheromones;
+    pheromones.reset(cdt, parameters.get<int>("regions", 4));
+    task_pool pool(std::min(threads, kappa));
+    vector<ant_result> ants(kappa);
+    pool.run(kappa, [&](int k)
+             {
+        ants[k].cdt = cdt;
+        ants[k].score = score; });
+    profile_count(COUNTER_CDT_COPIES, kappa);
+
+    int steiner_points = 0;
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        if (vit->info() < 0)
+            steiner_points++;
+    }
+    double energy = alpha * score.no_obtuse_faces + beta * steiner_points;
+    int start_steiner_points = steiner_points;
+    auto start = std::chrono::steady_clock::now();
+    long total_moves = 0;
+
+    for (int cycle = 0; cycle < L && score.no_obtuse_faces > 0; cycle++)
+    {
+        // Every adopted mesh has a lower energy and at least as many Steiner points, so it also has
+        // fewer obtuse faces: the current mesh is always the best one and stopping here loses nothing
+        if (should_stop(deadline))
+        {
+            LOG_INFO((cancelled() ? "Stop requested" : "Time limit reached") << " after " << cycle << " cycles");
+            break;
+        }
+
+        const run_control *control = current_control;
+        pool.run(kappa, [&](int k)
+                 { run_ant(steiner_points, constraints, region, pheromones, alpha, beta, xi, psi, moves,
+                           seed + cycle * kappa + k, deadline, control, ants[k]); });
+
+        // Evaporation, then every ant that beat the current mesh reinforces the choices it made
+        int best = -1;
+        for (auto &cell : pheromones.tau)
+            for (double &t : cell)
+                t = (1 - lambda) * t;
+        for (int k = 0; k < kappa; k++)
+        {
+            total_moves += ants[k].choices.size();
+            if (ants[k].energy >= energy)
+                continue;
+            for (const auto &choice : ants[k].choices)
+                pheromones.tau[choice.first][choice.second] += 1.0 / (1.0 + ants[k].energy);
+            if (best < 0 || ants[k].energy < ants[best].energy)
+                best = k;
+        }
+
+        if (best >= 0)
+        {
+            // The same points on the same mesh give the winner's mesh again. A replica whose rollback was
+            // not exact may have drifted, so the energy is taken from the colony's mesh and the move is
+            // undone if it is not lower there.
+            cdt_transaction adopt(cdt, &score);
+            adopt.begin();
+            for (const auto &point : ants[best].points)
+                adopt.insert(point);
+            double new_energy = alpha * score.no_obtuse_faces + beta * ants[best].steiner_points;
+            if (new_energy < energy)
+            {
+                adopt.commit();
+                steiner_points = ants[best].steiner_points;
+                energy = new_energy;
+                pool.run(kappa, [&](int k)
+                         { replay(ants[k].cdt, ants[k].score, ants[best].points); });
+
+                // A replica that no longer matches the colony's mesh is copied again
+                for (auto &ant : ants)
+                {
+                    if (ant.cdt.number_of_vertices() != cdt.number_of_vertices() || ant.score.no_obtuse_faces != score.no_obtuse_faces)
+                    {
+                        ant.cdt = cdt;
+                        ant.score = score;
+                        profile_count(COUNTER_CDT_COPIES);
+                    }
+                }
+            }
+            else
+                adopt.rollback();
+        }
+        LOG_DEBUG("Cycle " << cycle + 1 << ": energy " << energy << ", " << score.no_obtuse_faces << " obtuse faces, "
+                  << steiner_points << " Steiner points");
+        if (checkpoint != nullptr && checkpoint->due())
+            checkpoint->write(cdt);
+    }
+
+    // The handles of the old mesh are gone, the caller's index follows the new one
+    index.rebuild(cdt);
+    profile_count(COUNTER_STEINER_POINTS, steiner_points - start_steiner_points);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Ant colony: " << total_moves << " insertions by " << kappa << " ants on " << pool.size() << " threads, "
+             << (seconds > 0 ? total_moves / seconds : 0) << " insertions/s");
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "./func.h"
+#include <csignal>
+
+std::atomic<bool> stop_requested{false};
+thread_local run_control *current_control = nullptr;
+
+// Only sets the flag, the refinement loops see it at their next step. A second signal is not
+// caught any more and ends the process as usual.
+static void request_stop(int signal_number)
+{
+    stop_requested = true;
+    std::signal(signal_number, SIG_DFL);
+}
+
+void install_stop_handlers()
+{
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+}
+
+// A signal, or the portfolio cancelled the run of this thread
+bool cancelled()
+{
+    return stop_requested || (current_control != nullptr && current_control->cancel);
+}
+
+// Checked once per step of every refinement
+bool should_stop(std::chrono::steady_clock::time_point deadline)
+{
+    return should_stop(deadline, current_control);
+}
+
+// For the worker threads of a pool, which do not have the control of the run in current_control
+bool should_stop(std::chrono::steady_clock::time_point deadline, const run_control *control)
+{
+    return stop_requested || (control != nullptr && control->cancel) || std::chrono::steady_clock::now() >= deadline;
+}
+
+// Deadline seconds from now, no deadline for seconds <= 0
+std::chrono::steady_clock::time_point deadline_after(double seconds)
+{
+    if (seconds <= 0)
+        return std::chrono::steady_clock::time_point::max();
+    return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+void best_solution::start(const mesh_score &score)
+{
+    no_obtuse_faces = score.no_obtuse_faces;
+    prefix = 0;
+    added.clear();
+    if (current_control != nullptr)
+    {
+        current_control->no_obtuse_faces = no_obtuse_faces;
+        current_control->best_steiner_points = 0;
+        current_control->steiner_points = 0;
+    }
+}
+
+// Record a committed insertion, score is the mesh after it
+void best_solution::add(CDT::Vertex_handle vertex, const mesh_score &score)
+{
+    record(vertex);
+    offer(score);
+}
+
+// Record an insertion whose mesh is not scored yet (a batch of them is offered once at the end)
+void best_solution::record(CDT::Vertex_handle vertex)
+{
+    added.push_back(vertex);
+    if (current_control != nullptr)
+        current_control->steiner_points = added.size();
+}
+
+// The mesh with every recorded insertion, score is its score. The Steiner points only grow
+// along the run, so a mesh is better only if it has fewer obtuse faces.
+void best_solution::offer(const mesh_score &score)
+{
+    if (score.no_obtuse_faces < no_obtuse_faces)
+    {
+        no_obtuse_faces = score.no_obtuse_faces;
+        prefix = added.size();
+        if (current_control != nullptr)
+        {
+            current_control->no_obtuse_faces = no_obtuse_faces;
+            current_control->best_steiner_points = prefix;
+        }
+    }
+}
+
+// Remove the insertions after the best prefix, newest first. This gives back the best mesh only when the
+// mesh is a function of its points: after flips (flips_first) or an inexact rollback of simulated annealing
+// the triangulation without the later points can differ from the one that was scored, and be worse. So the
+// mesh before the removal is kept, and comes back when the result is worse than it or lost an input
+// constraint. Returns the number of points removed (0 when the mesh before was kept).
+int best_solution::restore(CDT &cdt, mesh_score &score, vertex_index &index, const vector<pair<Point_2, Point_2>> &constraints)
+{
+    if (added.size() <= prefix)
+        return 0;
+    CDT before = cdt;
+    profile_count(COUNTER_CDT_COPIES, 1);
+    int before_obtuse_faces = score.no_obtuse_faces;
+
+    int removed = 0;
+    while (added.size() > prefix)
+    {
+        index.remove(added.back()->point());
+        remove_steiner_point(cdt, added.back());
+        added.pop_back();
+        removed++;
+    }
+    score.rebuild(cdt);
+
+    bool constraints_kept = check_constraints(cdt, constraints);
+    if (!constraints_kept || score.no_obtuse_faces > before_obtuse_faces)
+    {
+        LOG_WARN("Restoring the best mesh gave " << score.no_obtuse_faces << " obtuse faces" << (constraints_kept ? "" : " and lost constraints")
+                 << ", the mesh before it has " << before_obtuse_faces << ", kept that one");
+        cdt.swap(before);
+        score.rebuild(cdt);
+        index.rebuild(cdt);
+        return 0;
+    }
+    if (score.no_obtuse_faces > no_obtuse_faces)
+        LOG_WARN("Restored mesh has " << score.no_obtuse_faces << " obtuse faces, the best mesh had " << no_obtuse_faces);
+    LOG_INFO("Best mesh restored: " << removed << " later Steiner points removed, " << score.no_obtuse_faces << " obtuse faces");
+    return removed;
+}
\ No newline at end of file
@@ -0,0 +1,236 @@
+#include "./func.h"
+#include <cstdlib>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+std::atomic<bool> arena_enabled{true};
+std::atomic<bool> arena_huge_pages{false};
+
+static const size_t slab_size = size_t(2) << 20; // One huge page
+static const size_t header_size = 16;            // Keeps the blocks 16 byte aligned
+
+static std::atomic<long> total_allocations{0};
+static std::atomic<long> total_reused{0};
+static std::atomic<long> total_system_allocations{0};
+static std::atomic<long> total_bytes_reserved{0};
+
+// In front of every block, tells deallocate where the block came from
+struct block_header
+{
+    memory_arena *owner; // nullptr: the block came from malloc
+    int size_class;
+};
+
+static size_t class_size(int size_class)
+{
+    return size_t(64) << size_class;
+}
+
+static int size_class_of(size_t bytes)
+{
+    int size_class = 0;
+    while (size_class < memory_arena::no_size_classes && class_size(size_class) < bytes)
+        size_class++;
+    return size_class;
+}
+
+static void *system_allocate(size_t bytes)
+{
+    void *block = std::malloc(bytes);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    total_system_allocations++;
+    return block;
+}
+
+// Slab aligned to its size, so that the kernel can back it with one huge page
+static void *allocate_slab(bool &mapped)
+{
+    mapped = false;
+#ifdef __linux__
+    if (arena_huge_pages)
+    {
+        void *area = mmap(nullptr, 2 * slab_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (area != MAP_FAILED)
+        {
+            char *start = static_cast<char *>(area);
+            char *slab = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(start) + slab_size - 1) & ~(slab_size - 1));
+            if (slab > start)
+                munmap(start, slab - start);
+            if (slab + slab_size < start + 2 * slab_size)
+                munmap(slab + slab_size, start + 2 * slab_size - (slab + slab_size));
+            madvise(slab, slab_size, MADV_HUGEPAGE);
+            mapped = true;
+            total_system_allocations++;
+            return slab;
+        }
+    }
+#endif
+    void *slab = std::aligned_alloc(slab_size, slab_size);
+    if (slab == nullptr)
+        throw std::bad_alloc();
+    total_system_allocations++;
+    return slab;
+}
+
+void *memory_arena::allocate(size_t bytes)
+{
+    total_allocations++;
+    int size_class = size_class_of(bytes + header_size);
+    block_header *header;
+    if (size_class >= no_size_classes)
+    {
+        header = static_cast<block_header *>(system_allocate(bytes + header_size));
+        header->owner = nullptr;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        void *block = free_blocks[size_class];
+        if (block != nullptr)
+        {
+            free_blocks[size_class] = *static_cast<void **>(block);
+            total_reused++;
+        }
+        else
+        {
+            size_t size = class_size(size_class);
+            if (next == nullptr || (size_t)(end - next) < size)
+            {
+                bool mapped;
+                next = static_cast<char *>(allocate_slab(mapped));
+                end = next + slab_size;
+                slabs.push_back({next, mapped});
+                total_bytes_reserved += slab_size;
+            }
+            block = next;
+            next += size;
+        }
+        live++;
+        header = static_cast<block_header *>(block);
+        header->owner = this;
+    }
+    header->size_class = size_class;
+    return reinterpret_cast<char *>(header) + header_size;
+}
+
+void memory_arena::deallocate(void *pointer)
+{
+    block_header *header = reinterpret_cast<block_header *>(static_cast<char *>(pointer) - header_size);
+    if (header->owner == nullptr)
+        std::free(header);
+    else
+        header->owner->free_block(header, header->size_class);
+}
+
+// The block goes back to the list of its size class. The last block of a retired arena
+// takes the arena with it.
+void memory_arena::free_block(void *block, int size_class)
+{
+    bool last;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        *static_cast<void **>(block) = free_blocks[size_class];
+        free_blocks[size_class] = block;
+        live--;
+        last = retired && live == 0;
+    }
+    if (last)
+    {
+        release_slabs();
+        delete this;
+    }
+}
+
+void memory_arena::release_slabs()
+{
+    for (const auto &slab : slabs)
+    {
+#ifdef __linux__
+        if (slab.second)
+        {
+            munmap(slab.first, slab_size);
+            continue;
+        }
+#endif
+        std::free(slab.first);
+    }
+    total_bytes_reserved -= slabs.size() * slab_size;
+    slabs.clear();
+    next = end = nullptr;
+    for (auto &list : free_blocks)
+        list = nullptr;
+}
+
+// Give every slab back at once, only possible when no block of the arena is in use
+bool memory_arena::release()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (live > 0)
+        return false;
+    release_slabs();
+    return true;
+}
+
+// Called when the thread of the arena exits, blocks it handed out may still be alive elsewhere
+void memory_arena::retire()
+{
+    bool empty;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        retired = true;
+        empty = live == 0;
+    }
+    if (empty)
+    {
+        release_slabs();
+        delete this;
+    }
+}
+
+// Arena of the calling thread, created on first use
+static memory_arena &thread_arena()
+{
+    struct arena_owner
+    {
+        memory_arena *arena = new memory_arena();
+        ~arena_owner() { arena->retire(); }
+    };
+    static thread_local arena_owner owner;
+    return *owner.arena;
+}
+
+void *arena_allocate(size_t bytes)
+{
+    if (arena_enabled)
+        return thread_arena().allocate(bytes);
+
+    total_allocations++;
+    block_header *header = static_cast<block_header *>(system_allocate(bytes + header_size));
+    header->owner = nullptr;
+    header->size_class = -1;
+    return reinterpret_cast<char *>(header) + header_size;
+}
+
+void arena_deallocate(void *pointer) noexcept
+{
+    if (pointer != nullptr)
+        memory_arena::deallocate(pointer);
+}
+
+// Between instances: the slabs of this thread go back to the system if none of its blocks is in use
+bool arena_release()
+{
+    return thread_arena().release();
+}
+
+arena_statistics arena_stats()
+{
+    arena_statistics stats;
+    stats.allocations = total_allocations;
+    stats.reused = total_reused;
+    stats.system_allocations = total_system_allocations;
+    stats.bytes_reserved = total_bytes_reserved;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "./func.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <signal.h>
+
+extern char **environ;
+
+namespace fs = std::filesystem;
+
+// Instance files of a directory (every *.json and *.bin, the .bin when both exist) or of a list file (one path per line)
+static vector<string> list_instances(const string &input)
+{
+    vector<string> files;
+    if (fs::is_directory(input))
+    {
+        for (const auto &entry : fs::directory_iterator(input))
+        {
+            if (!entry.is_regular_file())
+                continue;
+            fs::path path = entry.path();
+            if (path.extension() == ".bin" || (path.extension() == ".json" && !fs::exists(fs::path(path).replace_extension(".bin"))))
+                files.push_back(path.string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::ifstream list_file(input);
+    if (!list_file)
+    {
+        LOG_ERROR("Error: cannot open instance list " << input);
+        return files;
+    }
+    string line;
+    while (std::getline(list_file, line))
+    {
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] != '#')
+            files.push_back(line);
+    }
+    return files;
+}
+
+// threads is the share of the cores of this instance, the method may not use more (ant, tiles, portfolio, candidates)
+static batch_result solve_instance(const string &file_path, const string &output_dir, double time_limit, int threads, bool profile,
+                                   double checkpoint_interval, bool resume)
+{
+    // One profile per instance, the instances of this thread run one after the other
+    run_profile instance_profile;
+    current_profile = profile ? &instance_profile : nullptr;
+
+    batch_result result;
+    result.instance = fs::path(file_path).stem().string();
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = deadline_after(time_limit);
+
+    string instance_uid, method;
+    int num_constraints = 0;
+    vector<Point_2> points;
+    vector<int> region_boundary;
+    vector<pair<int, int>> additional_constraints;
+    ptree parameters;
+    bool delaunay;
+
+    try
+    {
+        profile_scope read_scope(PHASE_READ);
+        bool read_ok = read_instance_file(file_path, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay);
+        read_scope.stop();
+        if (!read_ok)
+        {
+            result.status = "read_error";
+            result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return result;
+        }
+
+        for (const char *key : {"threads", "candidate_threads"})
+        {
+            int requested = parameters.get<int>(key, 0);
+            if (requested <= 0 || requested > threads)
+                parameters.put(key, threads);
+        }
+
+        string checkpoint = (fs::path(output_dir) / (result.instance + ".checkpoint")).string();
+        if (checkpoint_interval > 0)
+        {
+            parameters.put("checkpoint", checkpoint);
+            parameters.put("checkpoint_interval", checkpoint_interval);
+        }
+        if (resume && fs::exists(checkpoint))
+            parameters.put("resume", checkpoint);
+
+        // On the time limit or a signal the refinement stops early and the best mesh it reached is written
+        CDT cdt = triangulation(points, region_boundary, additional_constraints, method, parameters, deadline);
+        if (stop_requested)
+            result.status = "interrupted";
+        else
+            result.status = std::chrono::steady_clock::now() >= deadline ? "time_limit" : "ok";
+
+        for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+        {
+            if (vit->info() < 0)
+                result.steiner_points++;
+        }
+        result.obtuse_faces = count_obtuse_faces(cdt);
+
+        string solution = (fs::path(output_dir) / (result.instance + ".solution.json")).string();
+        profile_scope write_scope(PHASE_WRITE_SOLUTION);
+        create_json_output(cdt, instance_uid, points.size(), solution);
+        write_scope.stop();
+        if (profile)
+            instance_profile.write_json(profile_file_name(solution), instance_uid);
+    }
+    catch (const std::exception &err)
+    {
+        // CGAL reports failed preconditions as exceptions, the other instances keep going
+        LOG_ERROR("Error in " << file_path << ": " << err.what());
+        result.status = "error";
+    }
+
+    result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// Child side of the batch (main --batch-instance): solve one instance and write the result row
+// (status, Steiner points, obtuse faces) to result_file for the parent
+int run_batch_instance(const string &file_path, const string &output_dir, const string &result_file, double time_limit, int threads,
+                       bool profile, double checkpoint_interval, bool resume)
+{
+    batch_result result = solve_instance(file_path, output_dir, time_limit, std::max(1, threads), profile, checkpoint_interval, resume);
+    std::ofstream out(result_file);
+    out << result.status << "," << result.steiner_points << "," << result.obtuse_faces << endl;
+    return out ? 0 : 1;
+}
+
+// Parent side: solve one instance in a child process of this executable. The child stops its refinement
+// at the time limit and writes its best mesh; a child still running kill_grace seconds after the limit is
+// killed, whatever part of the run it is in, and the instance gets the status "killed".
+static batch_result spawn_instance(const string &executable, const string &file_path, const string &output_dir, double time_limit,
+                                   double kill_grace, int threads, bool profile, double checkpoint_interval, bool resume)
+{
+    batch_result result;
+    result.instance = fs::path(file_path).stem().string();
+    string result_file = (fs::path(output_dir) / (result.instance + ".result")).string();
+    std::error_code ec;
+    fs::remove(result_file, ec);
+
+    vector<string> args = {executable, "--batch-instance", file_path, "--out", output_dir, "--result", result_file,
+                           "--time-limit", std::to_string(time_limit), "--threads", std::to_string(threads)};
+    if (profile)
+        args.push_back("--profile");
+    if (checkpoint_interval > 0)
+    {
+        args.push_back("--checkpoint-interval");
+        args.push_back(std::to_string(checkpoint_interval));
+    }
+    if (resume)
+        args.push_back("--resume");
+    if (!arena_enabled)
+        args.push_back("--no-arena");
+    if (arena_huge_pages)
+        args.push_back("--huge-pages");
+    vector<char *> argv;
+    for (auto &arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    // A group of its own, so that a Ctrl-C at the terminal reaches only the parent, which passes it on once
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid;
+    int spawned = posix_spawn(&pid, executable.c_str(), nullptr, &attributes, argv.data(), environ);
+    posix_spawnattr_destroy(&attributes);
+    if (spawned != 0)
+    {
+        LOG_ERROR("Error starting " << executable << " for " << file_path << ": " << std::strerror(spawned));
+        result.status = "error";
+        return result;
+    }
+
+    auto kill_at = deadline_after(time_limit > 0 ? time_limit + kill_grace : 0);
+    bool killed = false, forwarded = false;
+    int status = 0;
+    struct rusage usage = {};
+    while (true)
+    {
+        pid_t finished = wait4(pid, &status, WNOHANG, &usage);
+        if (finished == pid || finished < 0)
+            break;
+        if (stop_requested && !forwarded)
+        {
+            kill(pid, SIGTERM); // The child stops and writes its best mesh
+            forwarded = true;
+        }
+        if (!killed && std::chrono::steady_clock::now() >= kill_at)
+        {
+            LOG_WARN(result.instance << " is still running " << kill_grace << " s after its time limit, killed");
+            kill(pid, SIGKILL);
+            killed = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.peak_rss = usage.ru_maxrss / 1024.0; // Of the child alone, so of this instance
+
+    std::ifstream in(result_file);
+    string status_field;
+    char comma;
+    if (killed)
+        result.status = "killed";
+    else if (!(in && std::getline(in, status_field, ',') && in >> result.steiner_points >> comma >> result.obtuse_faces))
+        result.status = WIFEXITED(status) ? "error" : "crashed"; // A crash or a failed write leaves no result row
+    else
+        result.status = status_field;
+    in.close();
+    fs::remove(result_file, ec);
+    return result;
+}
+
+// Solve every instance of a directory or list file on a pool of threads (0 = one per core). The cores are
+// split between the instances that run at the same time, each instance's method gets its share as "threads".
+// Every instance runs in a child process of executable, so time_limit (seconds, 0 = none) holds for the whole
+// instance: the refinement stops at the limit, and a child that has not finished kill_grace seconds later
+// (10% of the limit, at least one second) is killed, in whatever part of the run it is stuck.
+// Each instance gets its own solution file in output_dir, the summary CSV has one row per instance.
+// With profile every instance also gets a profile report next to its solution. With checkpoint_interval > 0
+// every instance keeps a checkpoint next to its solution, resume continues from the ones left by an earlier run.
+// After SIGINT or SIGTERM the running instances write their best mesh and the rest are skipped.
+int run_batch(const string &input, const string &output_dir, int threads, double time_limit, const string &summary_file, bool profile,
+              double checkpoint_interval, bool resume, const string &executable)
+{
+    // The path of the running executable, argv[0] only where /proc is missing
+    string program = fs::exists("/proc/self/exe") ? string("/proc/self/exe") : executable;
+    double kill_grace = std::max(1.0, 0.1 * time_limit);
+
+    vector<string> files = list_instances(input);
+    if (files.empty())
+    {
+        LOG_ERROR("No instances found in " << input);
+        return 1;
+    }
+    fs::create_directories(output_dir);
+
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<int>(threads, files.size());
+    int instance_threads = std::max(1, (int)std::thread::hardware_concurrency() / threads);
+
+    // Largest files first, so that a big instance does not start last and hold up the run
+    vector<size_t> order(files.size());
+    vector<uintmax_t> sizes(files.size(), 0);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        order[i] = i;
+        std::error_code ec;
+        sizes[i] = fs::file_size(files[i], ec);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    LOG_INFO("Solving " << files.size() << " instances on " << threads << " threads, " << instance_threads << " per instance");
+    vector<batch_result> results(files.size());
+    std::atomic<size_t> next(0);
+    std::mutex progress_mutex;
+    size_t done = 0;
+
+    vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+    {
+        pool.emplace_back([&]()
+                          {
+            for (size_t k = next++; k < order.size(); k = next++)
+            {
+                size_t i = order[k];
+                if (stop_requested)
+                {
+                    results[i].instance = fs::path(files[i]).stem().string();
+                    results[i].status = "skipped";
+                    continue;
+                }
+                results[i] = spawn_instance(program, files[i], output_dir, time_limit, kill_grace, instance_threads, profile, checkpoint_interval, resume);
+
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                LOG_INFO("[" << ++done << "/" << files.size() << "] " << results[i].instance << ": " << results[i].status
+                         << ", " << results[i].steiner_points << " Steiner points, " << results[i].obtuse_faces
+                         << " obtuse faces, " << results[i].wall_time << " s");
+            } });
+    }
+    for (auto &worker : pool)
+        worker.join();
+
+    std::ofstream summary(summary_file);
+    if (!summary)
+    {
+        LOG_ERROR("Error opening file: " << summary_file);
+        return 1;
+    }
+    summary << "instance,status,steiner_points,obtuse_faces,wall_time_s,peak_rss_mb" << endl;
+    int failed = 0;
+    for (const auto &result : results)
+    {
+        summary << result.instance << "," << result.status << "," << result.steiner_points << ","
+                << result.obtuse_faces << "," << result.wall_time << "," << result.peak_rss << endl;
+        if (result.status != "ok" && result.status != "time_limit" && result.status != "interrupted")
+            failed++;
+    }
+    LOG_INFO("Summary written to " << summary_file << " (" << failed << " failed)");
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
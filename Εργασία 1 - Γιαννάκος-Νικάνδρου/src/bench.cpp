@@ -0,0 +1,592 @@
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include "./func.h"
+
+// Micro-benchmarks of the hot paths, one row per case, for the kernel the build was made with.
+// Usage: bench [--json file] [--warmup n] [--reps n] [--filter text] [--quick]
+
+using bench_clock = std::chrono::steady_clock;
+
+static double elapsed_us(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(bench_clock::now() - start).count();
+}
+
+// Result of one case, times are per operation
+class bench_result
+{
+public:
+    string name;
+    long size = 0;    // Faces of the mesh, edges of the region, points of the instance ...
+    long ops = 0;     // Operations timed per repetition
+    double bytes = 0; // Input bytes per repetition (readers only)
+    double ns_min = 0, ns_median = 0, ns_mean = 0;
+    vector<pair<string, long>> counters; // Profile counters of the last repetition (whole runs only)
+};
+
+static int warmup = 1;
+static int repetitions = 5;
+static string filter;
+static vector<bench_result> results;
+
+static bool selected(const string &name)
+{
+    return filter.empty() || name.find(filter) != string::npos;
+}
+
+// Runs setup + body warmup times, then repetitions times with only body timed.
+// body performs ops operations.
+template <class Setup, class Body>
+static void bench_case(const string &name, long size, long ops, Setup setup, Body body, double bytes = 0)
+{
+    if (!selected(name))
+        return;
+    for (int w = 0; w < warmup; w++)
+    {
+        setup();
+        body();
+    }
+
+    vector<double> times;
+    long allocations = 0, system_allocations = 0;
+    for (int r = 0; r < repetitions; r++)
+    {
+        setup();
+        arena_statistics before = arena_stats();
+        auto start = bench_clock::now();
+        body();
+        times.push_back(elapsed_us(start) * 1000 / ops);
+        arena_statistics after = arena_stats();
+        allocations += after.allocations - before.allocations;
+        system_allocations += after.system_allocations - before.system_allocations;
+    }
+    std::sort(times.begin(), times.end());
+
+    bench_result result;
+    result.name = name;
+    result.size = size;
+    result.ops = ops;
+    result.bytes = bytes;
+    result.ns_min = times.front();
+    result.ns_median = times[times.size() / 2];
+    for (double t : times)
+        result.ns_mean += t / times.size();
+    if (allocations > 0)
+    {
+        // Block allocations of the CGAL containers per repetition, and how many of them reached malloc or mmap
+        result.counters.push_back({"allocations", allocations / repetitions});
+        result.counters.push_back({"system_allocations", system_allocations / repetitions});
+    }
+    results.push_back(result);
+
+    cout << std::left << std::setw(36) << name << std::right << std::setw(10) << size
+         << std::setw(14) << result.ns_median << std::setw(14) << result.ns_min
+         << std::setw(14) << 1e9 / result.ns_median;
+    if (bytes > 0)
+        cout << std::setw(10) << bytes / ops / result.ns_median * 1000 << " MB/s"; // bytes per microsecond is MB/s
+    cout << endl;
+}
+
+template <class Body>
+static void bench_case(const string &name, long size, long ops, Body body)
+{
+    bench_case(name, size, ops, []() {}, body);
+}
+
+static void write_json_results(const string &filename)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return;
+    }
+    out << "{\n  \"kernel\": \"" << KERNEL_NAME << "\",\n  \"warmup\": " << warmup << ",\n  \"repetitions\": " << repetitions << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const bench_result &r = results[i];
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"ops\": " << r.ops
+            << ", \"ns_per_op_min\": " << r.ns_min << ", \"ns_per_op_median\": " << r.ns_median
+            << ", \"ns_per_op_mean\": " << r.ns_mean;
+        if (r.bytes > 0)
+            out << ", \"mb_per_s\": " << r.bytes / r.ops / r.ns_median * 1000;
+        for (const auto &counter : r.counters)
+            out << ", \"" << counter.first << "\": " << counter.second;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Random points in the CG:SHOP coordinate range
+static vector<Point_2> random_points(int n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> coord(0, 1000000);
+    vector<Point_2> points;
+    points.reserve(n);
+    for (int i = 0; i < n; i++)
+        points.emplace_back(coord(gen), coord(gen));
+    return points;
+}
+
+// Face of cdt that contains a random point
+static CDT::Face_handle random_face(const CDT &cdt, std::mt19937 &gen)
+{
+    std::uniform_int_distribution<int> coord(0, 1000000);
+    CDT::Face_handle face = cdt.locate(Point_2(coord(gen), coord(gen)));
+    while (cdt.is_infinite(face))
+        face = cdt.locate(Point_2(coord(gen), coord(gen)));
+    return face;
+}
+
+// Delaunay mesh of about faces random faces, the region is the square [0, 1000000]^2
+class bench_mesh
+{
+public:
+    CDT cdt;
+    vector<Point_2> points;
+    vector<int> region_boundary;
+    region_index region;
+
+    bench_mesh(int faces)
+    {
+        points = {Point_2(0, 0), Point_2(1000000, 0), Point_2(1000000, 1000000), Point_2(0, 1000000)};
+        region_boundary = {0, 1, 2, 3};
+        vector<Point_2> random = random_points(faces / 2, 42);
+        points.insert(points.end(), random.begin(), random.end());
+        for (size_t i = 0; i < points.size(); i++)
+            cdt.insert(points[i])->info() = i;
+        region.build(points, region_boundary);
+    }
+};
+
+// Triangle predicates on random triangles: three acos per face (angle_between_points, is_obtuse_triangle),
+// the dot product test one face at a time, and the batched kernel
+static void bench_predicates(int triangles)
+{
+    vector<Point_2> points = random_points(3 * triangles, 3);
+    triangle_batch batch;
+    batch.reserve(triangles);
+    for (int i = 0; i < triangles; i++)
+        batch.push_back(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
+    volatile double sink = 0; // Keeps the loops from being optimised away
+
+    bench_case("angle_between_points", triangles, triangles, [&]()
+               {
+        double sum = 0;
+        for (int i = 0; i < triangles; i++)
+            sum += angle_between_points(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
+        sink = sum; });
+
+    bench_case("is_obtuse_triangle", triangles, triangles, [&]()
+               {
+        int obtuse = 0;
+        for (int i = 0; i < triangles; i++)
+            obtuse += is_obtuse_triangle(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
+        sink = obtuse; });
+
+    bench_case("obtuse_vertex", triangles, triangles, [&]()
+               {
+        int obtuse = 0;
+        for (int i = 0; i < triangles; i++)
+            obtuse += obtuse_vertex(points[3 * i], points[3 * i + 1], points[3 * i + 2]) >= 0;
+        sink = obtuse; });
+
+    vector<int8_t> obtuse;
+    bench_case("classify_obtuse_batch_scalar", triangles, triangles, [&]()
+               { classify_obtuse_batch_scalar(batch, obtuse); });
+    bench_case("classify_obtuse_batch", triangles, triangles, [&]()
+               { classify_obtuse_batch(batch, obtuse); });
+}
+
+// Star shaped polygon with n vertices around (500000, 500000), always simple
+static void random_region(int n, unsigned seed, vector<Point_2> &points, vector<int> &region_boundary)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> radius(200000, 500000);
+    points.clear();
+    region_boundary.clear();
+    for (int i = 0; i < n; i++)
+    {
+        double angle = 2 * M_PI * i / n;
+        double r = radius(gen);
+        points.emplace_back(std::round(500000 + r * std::cos(angle)), std::round(500000 + r * std::sin(angle)));
+        region_boundary.push_back(i);
+    }
+}
+
+// Region membership: polygon rebuilt on every call (is_point_inside_constraints) against region_index
+static void bench_region(int n, int queries)
+{
+    vector<Point_2> points;
+    vector<int> region_boundary;
+    random_region(n, 11, points, region_boundary);
+    vector<pair<Point_2, Point_2>> constraints;
+    for (int i = 0; i < n; i++)
+        constraints.push_back({points[i], points[(i + 1) % n]});
+    vector<Point_2> query = random_points(queries, 13);
+    volatile int sink = 0;
+
+    // The old test rebuilds and validates the polygon per call, only a few calls are timed
+    int slow_queries = std::max(1, std::min(queries, 2000000 / n));
+    bench_case("is_point_inside_constraints", n, slow_queries, [&]()
+               {
+        int inside = 0;
+        for (int i = 0; i < slow_queries; i++)
+            inside += is_point_inside_constraints(query[i], constraints);
+        sink = inside; });
+
+    region_index region;
+    bench_case("region_index::build", n, 1, [&]()
+               { region.build(points, region_boundary); });
+
+    bench_case("region_index::contains", n, queries, [&]()
+               {
+        int inside = 0;
+        for (const auto &point : query)
+            inside += region.contains(point);
+        sink = inside; });
+
+    vector<int8_t> inside;
+    bench_case("region_index::contains batch", n, queries, [&]()
+               { region.contains(query, inside); });
+}
+
+// Queries and changes on a mesh of about faces faces, queries operations per repetition
+static void bench_mesh_operations(int faces, int queries)
+{
+    bench_mesh mesh(faces);
+    CDT &cdt = mesh.cdt;
+    long size = cdt.number_of_faces();
+    vector<pair<Point_2, Point_2>> constraints;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> coord(0, 1000000);
+    volatile double sink = 0;
+
+    // Half of the queries hit an existing vertex
+    vector<Point_2> query = random_points(queries, 19);
+    for (int i = 0; i < queries; i += 2)
+        query[i] = mesh.points[4 + i % (mesh.points.size() - 4)];
+
+    bench_case("point_exists_in_cdt", size, queries, [&]()
+               {
+        int found = 0;
+        for (const auto &point : query)
+            found += point_exists_in_cdt(point, cdt);
+        sink = found; });
+
+    vertex_index index;
+    index.rebuild(cdt);
+    bench_case("vertex_index::contains", size, queries, [&]()
+               {
+        int found = 0;
+        for (const auto &point : query)
+            found += index.contains(point);
+        sink = found; });
+
+    vector<CDT::Face_handle> sample;
+    for (int i = 0; i < queries; i++)
+        sample.push_back(random_face(cdt, gen));
+    bench_case("mean_point_of_adjacent_triangles", size, queries, [&]()
+               {
+        double sum = 0;
+        for (const auto &face : sample)
+            sum += CGAL::to_double(mean_point_of_adjacent_triangles(cdt, face, constraints).x());
+        sink = sum; });
+
+    mesh_score score;
+    score.rebuild(cdt);
+    vector<Point_2> candidates = random_points(queries, 29);
+    bench_case("evaluate_candidate", size, queries, [&]()
+               {
+        contender ct;
+        for (const auto &point : candidates)
+            evaluate_candidate(cdt, score, point, ct);
+        sink = ct.cdt_penalty_score; });
+
+    // Speculative moves: copy the CDT (what attempt_to_flip used to do) against the undo log
+    int copies = std::max(1, 2000000 / faces);
+    bench_case("cdt copy", size, copies, [&]()
+               {
+        for (int r = 0; r < copies; r++)
+        {
+            CDT copy = cdt;
+            sink = copy.number_of_faces();
+        } });
+
+    bench_case("copy + insert", size, copies, [&]()
+               {
+        for (int r = 0; r < copies; r++)
+        {
+            CDT copy = cdt;
+            copy.insert(Point_2(coord(gen) + 0.5, coord(gen) + 0.5));
+        } });
+
+    cdt_transaction trial(cdt, &score, &index);
+    bench_case("cdt_transaction insert + rollback", size, queries, [&]()
+               {
+        for (int r = 0; r < queries; r++)
+        {
+            trial.begin();
+            trial.insert(Point_2(coord(gen) + 0.5, coord(gen) + 0.5));
+            trial.rollback();
+        } });
+
+    bench_case("copy + flip", size, copies, [&]()
+               {
+        for (int r = 0; r < copies; r++)
+        {
+            CDT copy = cdt;
+            cdt_transaction(copy).flip(random_face(copy, gen), 0);
+        } });
+
+    bench_case("cdt_transaction flip + rollback", size, queries, [&]()
+               {
+        for (int r = 0; r < queries; r++)
+        {
+            trial.begin();
+            trial.flip(random_face(cdt, gen), 0);
+            trial.rollback();
+        } });
+
+    // Single Steiner insertion with the score kept in sync, on a fresh copy every repetition
+    CDT work;
+    mesh_score work_score;
+    vertex_index work_index;
+    bench_case("insert_and_score", size, queries, [&]()
+               {
+        work = cdt;
+        work_score.rebuild(work); }, [&]()
+               {
+        for (int r = 0; r < queries; r++)
+            insert_and_score(work, work_score, Point_2(coord(gen) + 0.5, coord(gen) + 0.5)); });
+
+    // Whole local search steps, worst obtuse face first, like the refinement loop (log lines are off),
+    // with the candidates evaluated on 1, 2, 4 and one thread per core (candidate_threads)
+    obtuse_worklist worklist;
+    int steps = std::min(queries, 200);
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    vector<int> thread_counts;
+    for (int threads : {1, 2, 4})
+        if (threads < cores)
+            thread_counts.push_back(threads);
+    thread_counts.push_back(cores);
+    for (int threads : thread_counts)
+    {
+        task_pool pool(threads);
+        string name = "add_steiner_point_local_search";
+        if (threads > 1)
+            name += " (" + std::to_string(threads) + " threads)";
+        bench_case(name, size, steps, [&]()
+                   {
+            work = cdt;
+            work_score.rebuild(work);
+            work_index.rebuild(work);
+            worklist = obtuse_worklist();
+            worklist.push_all_faces(work); }, [&]()
+                   {
+            CDT::Face_handle face;
+            int obtuse_index;
+            for (int r = 0; r < steps && worklist.pop(work, face, obtuse_index); r++)
+            {
+                CDT::Vertex_handle vertex;
+                if (add_steiner_point_local_search(work, CDT::Edge(face, obtuse_index), constraints, mesh.region, work_score, work_index, pool, vertex))
+                    worklist.push_incident_faces(work, vertex);
+            } });
+    }
+}
+
+// Initial triangulation of n random points: one insert per point in input order, against the
+// spatially sorted bulk insertion that triangulation uses
+static void bench_build(int n)
+{
+    vector<Point_2> points = random_points(n, 5);
+    vector<int> indices(n);
+    for (int i = 0; i < n; i++)
+        indices[i] = i;
+    CDT cdt;
+    auto clear = [&]()
+    { cdt.clear(); };
+
+    bench_case("insert points in input order", n, n, clear, [&]()
+               {
+        for (int i = 0; i < n; i++)
+            cdt.insert(points[i])->info() = i; });
+
+    vector<CDT::Vertex_handle> vertices;
+    bench_case("insert_points_sorted", n, n, clear, [&]()
+               { insert_points_sorted(cdt, points, indices, vertices); });
+}
+
+// Whole local search runs of steps insertions, with the counters that show how many steps the
+// kernel wastes on candidates it cannot use. Build with different KERNEL values to compare them.
+static void bench_refinement(int faces, int steps, const string &name = "triangulation local")
+{
+    if (!selected(name))
+        return;
+    bench_mesh mesh(faces);
+    ptree parameters;
+    parameters.put("L", steps);
+    vector<Point_2> points;
+    vector<int> region_boundary;
+    run_profile profile;
+
+    bench_case(name, mesh.cdt.number_of_faces(), steps, [&]()
+               {
+        points = mesh.points;
+        region_boundary = mesh.region_boundary;
+        profile = run_profile(); }, [&]()
+               {
+        current_profile = &profile;
+        triangulation(points, region_boundary, {}, "local", parameters);
+        current_profile = nullptr; });
+
+    bench_result &result = results.back();
+    for (profile_counter counter : {COUNTER_STEINER_POINTS, COUNTER_WASTED_STEPS, COUNTER_CANDIDATES, COUNTER_REJECTED_DUPLICATE,
+                                    COUNTER_REJECTED_OUTSIDE, COUNTER_REJECTED_NO_CONFLICT_ZONE})
+        result.counters.push_back({profile_counter_name(counter), profile.counters[counter]});
+    cout << "    ";
+    for (const auto &counter : result.counters)
+        cout << counter.first << " " << counter.second << "  ";
+    cout << endl;
+}
+
+// Copies of the CDT and whole refinement runs with the CGAL containers on malloc, to compare with
+// the same cases on the arena (the allocations counters show how many calls each one makes)
+static void bench_allocator(int faces, int steps)
+{
+    arena_enabled = false;
+    if (selected("cdt copy (malloc)"))
+    {
+        bench_mesh mesh(faces);
+        int copies = std::max(1, 2000000 / faces);
+        volatile size_t sink = 0;
+        bench_case("cdt copy (malloc)", mesh.cdt.number_of_faces(), copies, [&]()
+                   {
+            for (int r = 0; r < copies; r++)
+            {
+                CDT copy = mesh.cdt;
+                sink = copy.number_of_faces();
+            } });
+    }
+    bench_refinement(faces, steps, "triangulation local (malloc)");
+    arena_enabled = true;
+}
+
+// Instance file with n random points, written to filename, returns its size in bytes
+static double write_random_instance(const string &filename, int n)
+{
+    vector<Point_2> points = random_points(n, 17);
+    std::ofstream out(filename);
+    out << "{\n  \"instance_uid\": \"bench_" << n << "\",\n  \"num_points\": " << n << ",\n  \"points_x\": [";
+    for (int i = 0; i < n; i++)
+        out << (i ? ", " : "") << std::lround(CGAL::to_double(points[i].x()));
+    out << "],\n  \"points_y\": [";
+    for (int i = 0; i < n; i++)
+        out << (i ? ", " : "") << std::lround(CGAL::to_double(points[i].y()));
+    out << "],\n  \"region_boundary\": [0, 1, 2],\n  \"num_constraints\": " << n / 10 << ",\n  \"additional_constraints\": [";
+    for (int i = 0; i < n / 10; i++)
+        out << (i ? ", " : "") << "[" << i << ", " << i + 1 << "]";
+    out << "],\n  \"method\": \"local\",\n  \"parameters_local\": {\"L\": 1000},\n  \"delaunay\": true\n}\n";
+    return out.tellp();
+}
+
+// Parse throughput of the streaming reader against the ptree reader, and the mapped binary file
+static void bench_reader(int n)
+{
+    if (!selected("read_json_file") && !selected("read_binary_instance"))
+        return;
+    string filename = "bench_instance.json";
+    double bytes = write_random_instance(filename, n);
+
+    string instance_uid, method;
+    vector<Point_2> points;
+    vector<int> region_boundary;
+    int num_constraints;
+    vector<pair<int, int>> additional_constraints;
+    ptree parameters;
+    bool delaunay;
+    auto clear = [&]()
+    {
+        points.clear();
+        region_boundary.clear();
+        additional_constraints.clear();
+    };
+
+    bench_case("read_json_file", n, n, clear, [&]()
+               { read_json_file(filename, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay); }, bytes);
+    bench_case("read_json_file_ptree", n, n, clear, [&]()
+               { read_json_file_ptree(filename, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay); }, bytes);
+
+    // Same instance converted once, then mapped on every read
+    string binary_filename = "bench_instance.bin";
+    clear();
+    read_json_file(filename, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay);
+    write_binary_instance(binary_filename, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay);
+    std::ifstream binary_file(binary_filename, std::ios::binary | std::ios::ate);
+    double binary_bytes = binary_file.tellg();
+    binary_file.close();
+    bench_case("read_binary_instance", n, n, clear, [&]()
+               { read_binary_instance(binary_filename, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay); }, binary_bytes);
+    std::remove(binary_filename.c_str());
+    std::remove(filename.c_str());
+}
+
+int main(int argc, char *argv[])
+{
+    string json_file;
+    bool quick = false; // Smaller inputs, for a fast check
+    for (int i = 1; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option == "--quick")
+            quick = true;
+        else if (i + 1 >= argc)
+        {
+            cerr << "Missing value for " << option << endl;
+            return 1;
+        }
+        else if (option == "--json")
+            json_file = argv[++i];
+        else if (option == "--warmup")
+            warmup = std::max(0, std::stoi(argv[++i]));
+        else if (option == "--reps")
+            repetitions = std::max(1, std::stoi(argv[++i]));
+        else if (option == "--filter")
+            filter = argv[++i];
+        else
+        {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+
+    log_level = LOG_LEVEL_ERROR; // Only the table, whatever LOG_LEVEL the build has
+    cout << std::fixed << std::setprecision(2);
+    cout << std::left << std::setw(36) << "case" << std::right << std::setw(10) << "size" << std::setw(14) << "ns/op median"
+         << std::setw(14) << "ns/op min" << std::setw(14) << "ops/s" << endl;
+
+    bench_predicates(quick ? 100000 : 1000000);
+    bench_region(100, quick ? 100000 : 1000000);
+    bench_region(10000, quick ? 100000 : 1000000);
+    bench_mesh_operations(1000, 1000);
+    bench_mesh_operations(10000, 1000);
+    if (!quick)
+        bench_mesh_operations(100000, 1000);
+    bench_build(quick ? 100000 : 1000000);
+    bench_refinement(1000, 200);
+    if (!quick)
+        bench_refinement(10000, 200);
+    bench_allocator(10000, 200);
+    bench_reader(quick ? 100000 : 1000000);
+
+    if (!json_file.empty())
+        write_json_results(json_file);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "./func.h"
+#include <fstream>
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary instance file: a binary_instance_header followed by the arrays it points to.
+//   points       f64 x, f64 y per point (interleaved, 8 byte aligned)
+//   boundary     i32 per region_boundary entry
+//   constraints  i32 a, i32 b per additional constraint
+//   text         instance_uid, method and the parameters_<method> block as JSON
+// Little endian, written and read on the same kind of machine.
+
+static const char instance_magic[8] = {'O', 'B', 'T', 'I', 'N', 'S', 'T', '1'};
+
+static uint64_t align8(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+bool is_binary_instance_file(const string &file_path)
+{
+    return file_path.size() > 4 && file_path.compare(file_path.size() - 4, 4, ".bin") == 0;
+}
+
+bool write_binary_instance(const string &file_path, const string &instance_uid, const vector<Point_2> &points, const vector<int> &region_boundary, int num_constraints,
+                           const vector<pair<int, int>> &additional_constraints, const string &method, const ptree &parameters, bool delaunay)
+{
+    std::ostringstream parameters_json;
+    write_json(parameters_json, parameters, false);
+    string parameters_text = parameters_json.str();
+
+    binary_instance_header header;
+    std::memcpy(header.magic, instance_magic, sizeof(instance_magic));
+    header.delaunay = delaunay;
+    header.num_points = points.size();
+    header.num_boundary = region_boundary.size();
+    header.num_constraints = additional_constraints.size();
+    header.num_constraints_field = num_constraints;
+    header.points_offset = align8(sizeof(header));
+    header.boundary_offset = header.points_offset + 16 * header.num_points;
+    header.constraints_offset = header.boundary_offset + 4 * header.num_boundary;
+    header.uid_offset = header.constraints_offset + 8 * header.num_constraints;
+    header.uid_size = instance_uid.size();
+    header.method_offset = header.uid_offset + header.uid_size;
+    header.method_size = method.size();
+    header.parameters_offset = header.method_offset + header.method_size;
+    header.parameters_size = parameters_text.size();
+    header.file_size = header.parameters_offset + header.parameters_size;
+
+    vector<char> buffer(header.file_size, 0);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    double *xy = reinterpret_cast<double *>(buffer.data() + header.points_offset);
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        xy[2 * i] = CGAL::to_double(points[i].x());
+        xy[2 * i + 1] = CGAL::to_double(points[i].y());
+    }
+    int32_t *boundary = reinterpret_cast<int32_t *>(buffer.data() + header.boundary_offset);
+    for (size_t i = 0; i < region_boundary.size(); i++)
+        boundary[i] = region_boundary[i];
+    int32_t *constraints = reinterpret_cast<int32_t *>(buffer.data() + header.constraints_offset);
+    for (size_t i = 0; i < additional_constraints.size(); i++)
+    {
+        constraints[2 * i] = additional_constraints[i].first;
+        constraints[2 * i + 1] = additional_constraints[i].second;
+    }
+    std::memcpy(buffer.data() + header.uid_offset, instance_uid.data(), header.uid_size);
+    std::memcpy(buffer.data() + header.method_offset, method.data(), header.method_size);
+    std::memcpy(buffer.data() + header.parameters_offset, parameters_text.data(), header.parameters_size);
+
+    std::ofstream out(file_path, std::ios::binary | std::ios::trunc);
+    if (!out.write(buffer.data(), buffer.size()))
+    {
+        LOG_ERROR("Error writing file: " << file_path);
+        return false;
+    }
+    return true;
+}
+
+// The file is mapped, not read: the coordinates go from the page cache straight into points
+// (one memcpy when Point_2 is two doubles), so a repeated run over the same corpus does no parsing.
+bool read_binary_instance(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints,
+                          vector<pair<int, int>> &additional_constraints, string &method, ptree &parameters, bool &delaunay)
+{
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("Error opening file: " << file_path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(binary_instance_header))
+    {
+        LOG_ERROR(file_path << " is not a binary instance");
+        close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        LOG_ERROR("Error mapping file: " << file_path);
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char *base = static_cast<const char *>(mapping);
+
+    binary_instance_header header;
+    std::memcpy(&header, base, sizeof(header));
+    auto fits = [size](uint64_t offset, uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+    bool ok = std::memcmp(header.magic, instance_magic, sizeof(instance_magic)) == 0 && header.version == 1 &&
+              header.file_size == size && header.points_offset % 8 == 0 &&
+              header.num_points <= size / 16 && fits(header.points_offset, 16 * header.num_points) &&
+              header.num_boundary <= size / 4 && fits(header.boundary_offset, 4 * header.num_boundary) &&
+              header.num_constraints <= size / 8 && fits(header.constraints_offset, 8 * header.num_constraints) &&
+              fits(header.uid_offset, header.uid_size) && fits(header.method_offset, header.method_size) &&
+              fits(header.parameters_offset, header.parameters_size);
+    if (!ok)
+    {
+        LOG_ERROR(file_path << " is not a binary instance or is truncated");
+        munmap(mapping, size);
+        return false;
+    }
+
+    instance_uid.assign(base + header.uid_offset, header.uid_size);
+    method.assign(base + header.method_offset, header.method_size);
+    delaunay = header.delaunay != 0;
+    num_constraints = header.num_constraints_field;
+
+    const double *xy = reinterpret_cast<const double *>(base + header.points_offset);
+    size_t first = points.size();
+    if (std::is_same<Kernel, CGAL::Simple_cartesian<double>>::value && sizeof(Point_2) == 2 * sizeof(double) &&
+        std::is_trivially_copyable<Point_2>::value)
+    {
+        points.resize(first + header.num_points);
+        std::memcpy(static_cast<void *>(points.data() + first), xy, 16 * header.num_points);
+    }
+    else
+    {
+        points.reserve(first + header.num_points);
+        for (uint64_t i = 0; i < header.num_points; i++)
+            points.emplace_back(xy[2 * i], xy[2 * i + 1]);
+    }
+
+    const int32_t *boundary = reinterpret_cast<const int32_t *>(base + header.boundary_offset);
+    region_boundary.insert(region_boundary.end(), boundary, boundary + header.num_boundary);
+    const int32_t *constraints = reinterpret_cast<const int32_t *>(base + header.constraints_offset);
+    additional_constraints.reserve(additional_constraints.size() + header.num_constraints);
+    for (uint64_t i = 0; i < header.num_constraints; i++)
+        additional_constraints.emplace_back(constraints[2 * i], constraints[2 * i + 1]);
+
+    string parameters_text(base + header.parameters_offset, header.parameters_size);
+    munmap(mapping, size);
+    try
+    {
+        std::istringstream parameters_stream(parameters_text);
+        read_json(parameters_stream, parameters);
+    }
+    catch (const json_parser_error &err)
+    {
+        LOG_ERROR("Error parsing the parameters of " << file_path << ": " << err.what());
+        return false;
+    }
+    return true;
+}
+
+// Instance file in either format, picked by the extension (.bin is binary, anything else JSON)
+bool read_instance_file(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints,
+                        vector<pair<int, int>> &additional_constraints, string &method, ptree &parameters, bool &delaunay)
+{
+    if (is_binary_instance_file(file_path))
+        return read_binary_instance(file_path, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay);
+    return read_json_file(file_path, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay);
+}
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "./func.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+// Snapshot layout, little endian, no padding:
+//   "OBTCKPT1"
+//   u64 vertices,    then per vertex: f64 x, f64 y, i32 info
+//   u64 constraints, then per constrained edge: u32 a, u32 b (vertex numbers)
+//   u64 steiner,     then per Steiner point: u32 vertex number
+//   u64 FNV-1a hash of everything before it
+// Coordinates are stored as doubles, the same precision as the solution file.
+
+static const char checkpoint_magic[8] = {'O', 'B', 'T', 'C', 'K', 'P', 'T', '1'};
+
+static uint64_t fnv1a(const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <class T>
+static void put(vector<char> &buffer, T value)
+{
+    size_t at = buffer.size();
+    buffer.resize(at + sizeof(T));
+    std::memcpy(&buffer[at], &value, sizeof(T));
+}
+
+template <class T>
+static bool get(const char *&p, const char *end, T &value)
+{
+    if ((size_t)(end - p) < sizeof(T))
+        return false;
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+// The snapshot is written next to filename and renamed over it, a run killed while
+// writing leaves the previous checkpoint in place
+bool write_checkpoint(const string &filename, const CDT &cdt)
+{
+    profile_scope checkpoint_scope(PHASE_CHECKPOINT);
+    std::unordered_map<const void *, uint32_t> number;
+    number.reserve(cdt.number_of_vertices());
+
+    vector<char> buffer;
+    buffer.reserve(sizeof(checkpoint_magic) + 8 + cdt.number_of_vertices() * 24);
+    buffer.insert(buffer.end(), checkpoint_magic, checkpoint_magic + sizeof(checkpoint_magic));
+    put<uint64_t>(buffer, cdt.number_of_vertices());
+    vector<uint32_t> steiner;
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        uint32_t n = number.size();
+        number[&*vit] = n;
+        put<double>(buffer, CGAL::to_double(vit->point().x()));
+        put<double>(buffer, CGAL::to_double(vit->point().y()));
+        put<int32_t>(buffer, vit->info());
+        if (vit->info() < 0)
+            steiner.push_back(n);
+    }
+
+    vector<pair<uint32_t, uint32_t>> constrained;
+    for (CDT::Finite_edges_iterator eit = cdt.finite_edges_begin(); eit != cdt.finite_edges_end(); eit++)
+    {
+        if (!cdt.is_constrained(*eit))
+            continue;
+        constrained.push_back({number[&*eit->first->vertex(cdt.ccw(eit->second))],
+                               number[&*eit->first->vertex(cdt.cw(eit->second))]});
+    }
+    put<uint64_t>(buffer, constrained.size());
+    for (const auto &edge : constrained)
+    {
+        put<uint32_t>(buffer, edge.first);
+        put<uint32_t>(buffer, edge.second);
+    }
+
+    put<uint64_t>(buffer, steiner.size());
+    for (uint32_t n : steiner)
+        put<uint32_t>(buffer, n);
+    put<uint64_t>(buffer, fnv1a(buffer.data(), buffer.size()));
+
+    string temporary = filename + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.write(buffer.data(), buffer.size()))
+        {
+            LOG_ERROR("Error writing checkpoint: " << temporary);
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0)
+    {
+        LOG_ERROR("Error renaming " << temporary << " to " << filename);
+        return false;
+    }
+    LOG_DEBUG("Checkpoint written: " << filename << " (" << number.size() << " vertices, " << steiner.size() << " Steiner points)");
+    return true;
+}
+
+// Rebuild the CDT of a checkpoint. The vertices go in with their info, then the constrained edges.
+bool read_checkpoint(const string &filename, CDT &cdt)
+{
+    profile_scope checkpoint_scope(PHASE_CHECKPOINT);
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    if (!in)
+    {
+        LOG_ERROR("Error opening checkpoint: " << filename);
+        return false;
+    }
+    vector<char> buffer((size_t)in.tellg());
+    in.seekg(0);
+    if (!in.read(buffer.data(), buffer.size()))
+    {
+        LOG_ERROR("Error reading checkpoint: " << filename);
+        return false;
+    }
+
+    uint64_t stored_hash;
+    if (buffer.size() < sizeof(checkpoint_magic) + sizeof(stored_hash) ||
+        std::memcmp(buffer.data(), checkpoint_magic, sizeof(checkpoint_magic)) != 0)
+    {
+        LOG_ERROR(filename << " is not a checkpoint");
+        return false;
+    }
+    std::memcpy(&stored_hash, buffer.data() + buffer.size() - sizeof(stored_hash), sizeof(stored_hash));
+    if (fnv1a(buffer.data(), buffer.size() - sizeof(stored_hash)) != stored_hash)
+    {
+        LOG_ERROR("Checkpoint " << filename << " is damaged");
+        return false;
+    }
+
+    const char *p = buffer.data() + sizeof(checkpoint_magic);
+    const char *end = buffer.data() + buffer.size() - sizeof(stored_hash);
+    uint64_t no_vertices;
+    if (!get(p, end, no_vertices) || no_vertices > (uint64_t)(end - p) / 20)
+    {
+        LOG_ERROR("Checkpoint " << filename << " is truncated");
+        return false;
+    }
+
+    vector<Point_2> points;
+    vector<int> infos(no_vertices), indices(no_vertices);
+    points.reserve(no_vertices);
+    for (uint64_t i = 0; i < no_vertices; i++)
+    {
+        double x, y;
+        if (!get(p, end, x) || !get(p, end, y) || !get(p, end, infos[i]))
+        {
+            LOG_ERROR("Checkpoint " << filename << " is truncated");
+            return false;
+        }
+        points.emplace_back(x, y);
+        indices[i] = i;
+    }
+
+    cdt.clear();
+    vector<CDT::Vertex_handle> vertices;
+    insert_points_sorted(cdt, points, indices, vertices);
+    for (uint64_t i = 0; i < no_vertices; i++)
+        vertices[i]->info() = infos[i];
+
+    uint64_t no_constraints, no_steiner;
+    if (!get(p, end, no_constraints) || no_constraints > (uint64_t)(end - p) / 8)
+    {
+        LOG_ERROR("Checkpoint " << filename << " is truncated");
+        cdt.clear();
+        return false;
+    }
+    for (uint64_t i = 0; i < no_constraints; i++)
+    {
+        uint32_t a, b;
+        if (!get(p, end, a) || !get(p, end, b))
+        {
+            LOG_ERROR("Checkpoint " << filename << " is truncated");
+            cdt.clear();
+            return false;
+        }
+        if (a >= no_vertices || b >= no_vertices)
+        {
+            LOG_ERROR("Checkpoint " << filename << " has a constraint on a missing vertex");
+            cdt.clear();
+            return false;
+        }
+        cdt.insert_constraint(vertices[a], vertices[b]);
+    }
+
+    if (!get(p, end, no_steiner) || no_steiner != (uint64_t)(end - p) / 4)
+    {
+        LOG_ERROR("Checkpoint " << filename << " is truncated");
+        cdt.clear();
+        return false;
+    }
+    for (uint64_t i = 0; i < no_steiner; i++)
+    {
+        uint32_t n;
+        if (!get(p, end, n))
+        {
+            LOG_ERROR("Checkpoint " << filename << " is truncated");
+            cdt.clear();
+            return false;
+        }
+        if (n < no_vertices)
+            vertices[n]->info() = -1;
+    }
+
+    LOG_INFO("Resumed from " << filename << ": " << no_vertices << " vertices, " << no_constraints << " constrained edges, "
+             << no_steiner << " Steiner points");
+    return true;
+}
+
+bool checkpoint_writer::due() const
+{
+    return !filename.empty() && std::chrono::steady_clock::now() - last >= std::chrono::duration<double>(interval);
+}
+
+bool checkpoint_writer::write(const CDT &cdt)
+{
+    last = std::chrono::steady_clock::now();
+    return write_checkpoint(filename, cdt);
+}
\ No newline at end of file
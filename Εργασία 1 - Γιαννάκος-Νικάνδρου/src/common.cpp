@@ -1,14 +1,15 @@
 #include "./func.h"
 #include <iostream>
+#include <algorithm>
 
 // γωνια που σχηματιζουν p1, p2, p3, ελεγχος για αμβλυγωνιο (επιστρεφει τιμη >90º)
 double angle_between_points(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
 {
     Kernel::Vector_2 v1 = p2 - p1;                        // διανυσμα που ξεκιναει απο p1 προς p2
     Kernel::Vector_2 v2 = p3 - p1;                        // διανυσμα που ξεκιναει απο p1 προς p3
-    double dot_product = v1 * v2;                         // εσωτερικο γινομενο
-    double magnitude_v1 = std::sqrt(v1.squared_length()); // μέτρο διανυσματος
-    double magnitude_v2 = std::sqrt(v2.squared_length()); // μέτρο διανυσματος
+    double dot_product = CGAL::to_double(v1 * v2);        // εσωτερικο γινομενο
+    double magnitude_v1 = std::sqrt(CGAL::to_double(v1.squared_length())); // μέτρο διανυσματος
+    double magnitude_v2 = std::sqrt(CGAL::to_double(v2.squared_length())); // μέτρο διανυσματος
 
     // Ελεγχος για μηδενικο διανυσμα για αποφύγης διαίρεσης με το μηδέν
     if (magnitude_v1 == 0 || magnitude_v2 == 0)
@@ -24,10 +25,7 @@ double angle_between_points(const Point_2 &p1, const Point_2 &p2, const Point_2
 
 bool is_obtuse_triangle(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
 {
-    double angle1 = angle_between_points(p1, p2, p3);
-    double angle2 = angle_between_points(p2, p1, p3);
-    double angle3 = angle_between_points(p3, p1, p2);
-    return (angle1 > 90 || angle2 > 90 || angle3 > 90);
+    return obtuse_vertex(p1, p2, p3) >= 0;
 }
 
 void check_cdt_validity(const CDT &cdt)
@@ -36,13 +34,47 @@ void check_cdt_validity(const CDT &cdt)
     {
         if (!fit->is_valid())
         {
-            std::cerr << "Invalid face detected!" << endl;
+            LOG_ERROR("Invalid face detected!");
         }
     }
     // cout << "All Faces valid for now..." << endl;
     return;
 }
 
+// End points of every constraint of the hierarchy. The Steiner points only split a constraint,
+// so these are the input constraints that were inserted.
+void constraint_end_points(const CDT &cdt, vector<pair<Point_2, Point_2>> &constraints)
+{
+    constraints.clear();
+    for (CDT::Constraint_iterator cit = cdt.constraints_begin(); cit != cdt.constraints_end(); ++cit)
+    {
+        CDT::Vertex_handle first = *cdt.vertices_in_constraint_begin(*cit);
+        CDT::Vertex_handle last = *std::prev(cdt.vertices_in_constraint_end(*cit));
+        constraints.push_back({first->point(), last->point()});
+    }
+}
+
+// Every input constraint is still a constraint of the CDT, from one end point to the other
+bool check_constraints(const CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints)
+{
+    vector<pair<Point_2, Point_2>> present;
+    constraint_end_points(cdt, present);
+    std::set<pair<Point_2, Point_2>> ends;
+    for (const auto &constraint : present)
+        ends.insert(std::minmax(constraint.first, constraint.second));
+
+    int missing = 0;
+    for (const auto &constraint : constraints)
+    {
+        if (ends.count(std::minmax(constraint.first, constraint.second)) == 0)
+        {
+            LOG_ERROR("Constraint (" << constraint.first << ") - (" << constraint.second << ") is missing from the triangulation");
+            missing++;
+        }
+    }
+    return missing == 0;
+}
+
 bool is_point_inside_constraints(const Point_2 &point, const std::vector<std::pair<Point_2, Point_2>> &constraints)
 {
     // Create a set of unique points from the constraints (ensures no duplicate points)
@@ -56,7 +88,7 @@ bool is_point_inside_constraints(const Point_2 &point, const std::vector<std::pa
     // If there are not enough points to form a polygon, return false (degenerate case)
     if (unique_points.size() < 3)
     {
-        std::cerr << "Constraints form a degenerate polygon (less than 3 unique points)." << std::endl;
+        LOG_WARN("Constraints form a degenerate polygon (less than 3 unique points).");
         return false;
     }
 
@@ -70,7 +102,7 @@ bool is_point_inside_constraints(const Point_2 &point, const std::vector<std::pa
     // Ensure the polygon is simple (non-self-intersecting)
     if (!constraint_polygon.is_simple())
     {
-        std::cerr << "Constraints form a non-simple polygon!" << std::endl;
+        LOG_WARN("Constraints form a non-simple polygon!");
         return false;
     }
 
@@ -85,30 +117,23 @@ void analyze_obtuse_angles(const CDT &cdt)
 {
     int obtuse_count = 0; // Counter for obtuse angles
 
-    cout << "Analyzing triangles for obtuse angles...\n";
+    LOG_INFO("Analyzing triangles for obtuse angles...");
+
+    obtuse_count = count_obtuse_faces(cdt);
+    LOG_INFO("Total obtuse angles found: " << obtuse_count);
+}
 
+// Number of obtuse faces, all faces are classified at once and no angle is computed
+int count_obtuse_faces(const CDT &cdt)
+{
+    triangle_batch batch;
+    batch.reserve(cdt.number_of_faces());
     for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); ++face_it)
-    {
-        // Get the points of the triangle
-        Point_2 p1 = face_it->vertex(0)->point();
-        Point_2 p2 = face_it->vertex(1)->point();
-        Point_2 p3 = face_it->vertex(2)->point();
-
-        // Calculate angles
-        double angle1 = angle_between_points(p1, p2, p3);
-        double angle2 = angle_between_points(p2, p1, p3);
-        double angle3 = angle_between_points(p3, p1, p2);
-
-        // Check for obtuse angles
-        if (angle1 > 90 || angle2 > 90 || angle3 > 90)
-        {
-            obtuse_count++;
-            // cout << "Obtuse triangle found:\n";
-            // cout << "  Vertices: (" << p1 << "), (" << p2 << "), (" << p3 << ")\n";
-            // cout << "  Angles: " << angle1 << "°, " << angle2 << "°, " << angle3 << "°\n";
-        }
-    }
-    cout << "Total obtuse angles found: " << obtuse_count << "\n";
+        batch.push_back(face_it->vertex(0)->point(), face_it->vertex(1)->point(), face_it->vertex(2)->point());
+
+    vector<int8_t> obtuse;
+    classify_obtuse_batch(batch, obtuse);
+    return std::count_if(obtuse.begin(), obtuse.end(), [](int8_t vertex) { return vertex >= 0; });
 }
 
 Point_2 mean_point_of_adjacent_triangles(CDT &cdt, CDT::Face_handle face, const vector<pair<Point_2, Point_2>> &constraints)
@@ -152,17 +177,18 @@ Point_2 project_point_on_segment(const Point_2 &p, const Segment_2 &s)
     return line.projection(p);
 }
 
-// Function to check if a point already exists in the CDT
+// Function to check if a point already exists in the CDT.
+// Point location lands on a vertex exactly when the point is already there, so there is
+// no need to scan every vertex. The refinement loop uses a vertex_index instead.
 bool point_exists_in_cdt(const Point_2 &point, const CDT &cdt)
 {
-    for (auto vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); ++vit)
-    {
-        if (vit->point() == point)
-        {
-            return true; // Point exists
-        }
-    }
-    return false; // Point does not exist
+    if (cdt.number_of_vertices() == 0)
+        return false;
+
+    CDT::Locate_type lt;
+    int li;
+    cdt.locate(point, lt, li);
+    return lt == CDT::VERTEX;
 }
 
 string get_steiner_point_method(int i)
@@ -182,4 +208,25 @@ string get_steiner_point_method(int i)
     default:
         return "Unknown Method"; // Fallback for invalid indices
     }
+}
+
+// Steiner point of method i (same numbering as get_steiner_point_method) for the obtuse face of edge
+Point_2 get_steiner_point(CDT &cdt, const CDT::Edge &edge, const vector<pair<Point_2, Point_2>> &constraints, int i)
+{
+    const Point_2 &p1 = edge.first->vertex((edge.second + 1) % 3)->point();
+    const Point_2 &p2 = edge.first->vertex((edge.second + 2) % 3)->point();
+    const Point_2 &obtuse = edge.first->vertex(edge.second)->point();
+    switch (i)
+    {
+    case 0:
+        return CGAL::circumcenter(p1, p2, obtuse);
+    case 1:
+        return CGAL::midpoint(p1, p2); // Midpoint of the longest edge
+    case 2:
+        return project_point_on_segment(obtuse, Segment_2(p1, p2));
+    case 3:
+        return CGAL::centroid(p1, p2, obtuse);
+    default:
+        return mean_point_of_adjacent_triangles(cdt, edge.first, constraints);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include <iostream>
+#include "./func.h"
+
+// JSON instances to the binary format of binary_io.cpp, for corpora that are solved again and again.
+// Usage: convert <instance.json>... (each one is written next to it as instance.bin)
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <instance.json>..." << endl;
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        string input = argv[i];
+        string output = input;
+        if (output.size() > 5 && output.compare(output.size() - 5, 5, ".json") == 0)
+            output.erase(output.size() - 5);
+        output += ".bin";
+
+        string instance_uid, method;
+        int num_constraints = 0;
+        vector<Point_2> points;
+        vector<int> region_boundary;
+        vector<pair<int, int>> additional_constraints;
+        ptree parameters;
+        bool delaunay = true;
+        if (!read_json_file(input, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay) ||
+            !write_binary_instance(output, instance_uid, points, region_boundary, num_constraints, additional_constraints, method, parameters, delaunay))
+        {
+            failed++;
+            continue;
+        }
+        cout << input << " -> " << output << ": " << points.size() << " points" << endl;
+    }
+    return failed > 0 ? 1 : 0;
+}
\ No newline at end of file
@@ -1,19 +1,15 @@
-#include <CGAL/Constrained_Delaunay_triangulation_2.h>
-#include <CGAL/Simple_cartesian.h>
+#include "./func.h"
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <cmath>
 
-typedef CGAL::Simple_cartesian<double> K;
-typedef CGAL::Constrained_Delaunay_triangulation_2<K> CDT;
-
 void export_to_svg(const CDT &cdt, const std::string &filename)
 {
     std::ofstream ofs(filename);
     if (!ofs)
     {
-        std::cerr << "Error: Cannot open file " << filename << " for writing." << std::endl;
+        LOG_ERROR("Error: Cannot open file " << filename << " for writing.");
         return;
     }
 
@@ -26,10 +22,10 @@ void export_to_svg(const CDT &cdt, const std::string &filename)
     for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); ++vit)
     {
         auto point = vit->point();
-        min_x = std::min(min_x, point.x());
-        max_x = std::max(max_x, point.x());
-        min_y = std::min(min_y, point.y());
-        max_y = std::max(max_y, point.y());
+        min_x = std::min(min_x, CGAL::to_double(point.x()));
+        max_x = std::max(max_x, CGAL::to_double(point.x()));
+        min_y = std::min(min_y, CGAL::to_double(point.y()));
+        max_y = std::max(max_y, CGAL::to_double(point.y()));
     }
 
     // Scale factor to fit the entire triangulation in a 500x500 SVG canvas
@@ -50,10 +46,10 @@ void export_to_svg(const CDT &cdt, const std::string &filename)
         auto segment = cdt.segment(*eit);
 
         // Apply scaling and translation
-        double x1 = (segment.source().x() - min_x) * scale;
-        double y1 = (segment.source().y() - min_y) * scale;
-        double x2 = (segment.target().x() - min_x) * scale;
-        double y2 = (segment.target().y() - min_y) * scale;
+        double x1 = (CGAL::to_double(segment.source().x()) - min_x) * scale;
+        double y1 = (CGAL::to_double(segment.source().y()) - min_y) * scale;
+        double x2 = (CGAL::to_double(segment.target().x()) - min_x) * scale;
+        double y2 = (CGAL::to_double(segment.target().y()) - min_y) * scale;
 
         ofs << "<line x1=\"" << x1 << "\" y1=\"" << height - y1 // Invert y-axis for SVG coordinate system
             << "\" x2=\"" << x2 << "\" y2=\"" << height - y2
@@ -66,8 +62,8 @@ void export_to_svg(const CDT &cdt, const std::string &filename)
         auto point = vit->point();
 
         // Apply scaling and translation
-        double x = (point.x() - min_x) * scale;
-        double y = (point.y() - min_y) * scale;
+        double x = (CGAL::to_double(point.x()) - min_x) * scale;
+        double y = (CGAL::to_double(point.y()) - min_y) * scale;
 
         ofs << "<circle cx=\"" << x << "\" cy=\"" << height - y // Invert y-axis for SVG coordinate system
             << "\" r=\"3\" fill=\"red\" />\n";
@@ -75,5 +71,5 @@ void export_to_svg(const CDT &cdt, const std::string &filename)
 
     ofs << "</svg>\n";
     ofs.close();
-    std::cout << "Triangulation exported to " << filename << std::endl;
+    LOG_INFO("Triangulation exported to " << filename);
 }
@@ -1,7 +1,8 @@
 #include "./func.h"
 #include <iostream>
+#include <thread>
 
-bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vector<pair<Point_2, Point_2>> &constraints)
+bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index, task_pool &pool, CDT::Vertex_handle &inserted_vertex)
 {
     // Valid Steiner point candidates
     std::vector<Point_2> candidate_points;
@@ -10,7 +11,7 @@ bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vecto
     // Check if the edge is valid
     if (!edge.first->is_valid())
     {
-        cerr << "Invalid edge detected, skipping Steiner point insertion" << endl;
+        LOG_TRACE("Invalid edge detected, skipping Steiner point insertion");
         return false;
     }
 
@@ -20,90 +21,75 @@ bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vecto
     // Validate the face handle and vertices
     if (vh1 == nullptr || vh2 == nullptr)
     {
-        std::cerr << "Invalid vertices detected, skipping Steiner point insertion." << endl;
+        LOG_TRACE("Invalid vertices detected, skipping Steiner point insertion.");
         return false;
     }
 
     // Check for degeneracy before circumcenter calculation (εκφυλισμένη κορυφή)
     if (CGAL::collinear(vh1->point(), vh2->point(), edge.first->vertex(edge.second)->point()))
     {
-        cerr << "Degenerate triangle detected, skipping Steiner point calculation" << endl;
+        LOG_TRACE("Degenerate triangle detected, skipping Steiner point calculation");
         return false; // To avoid inserting into an invalid edge
     }
 
-    // Attempt to use the circumcenter as the Steiner point
-    Point_2 circumcenter = CGAL::circumcenter(vh1->point(), vh2->point(), edge.first->vertex(edge.second)->point());
-    candidate_points.push_back(circumcenter);
-    // Midpoint of the longest Edge
-    Point_2 midpoint = CGAL::midpoint(vh1->point(), vh2->point());
-    candidate_points.push_back(midpoint);
-    // Projection of the obtuse vertex onto the opposite edge
-    Point_2 projection = project_point_on_segment(edge.first->vertex(edge.second)->point(), CGAL::Segment_2<Kernel>(vh1->point(), vh2->point()));
-    candidate_points.push_back(projection);
-    // Centroid of the triangle
-    Point_2 centroid = CGAL::centroid(vh1->point(), vh2->point(), edge.first->vertex(edge.second)->point());
-    candidate_points.push_back(centroid);
-    // Mean point of adjacent obtuse triangles
-    Point_2 mean_point = mean_point_of_adjacent_triangles(cdt, edge.first, constraints);
-    candidate_points.push_back(mean_point);
-
-    for (int i = 0; i < candidate_points.size(); i++)
+    // Circumcenter, midpoint of the longest edge, projection of the obtuse vertex onto the opposite edge,
+    // centroid of the triangle and mean point of the adjacent obtuse triangles
+    for (int i = 0; i < 5; i++)
+        candidate_points.push_back(get_steiner_point(cdt, edge, constraints, i));
+    profile_count(COUNTER_CANDIDATES, 5);
+
+    // The checks and the point location run here, point location is not thread safe
+    profile_scope evaluate_scope(PHASE_EVALUATE_CANDIDATES);
+    int no_candidates = candidate_points.size();
+    vector<int> located;
+    vector<CDT::Face_handle> start_faces(no_candidates);
+    vector<CDT::Locate_type> locate_types(no_candidates);
+    vector<int> locate_indices(no_candidates);
+    for (int i = 0; i < no_candidates; i++)
     {
         // Validate if the point is within constraints or already exists in the CDT
-        if (point_exists_in_cdt(candidate_points[i], cdt))
+        if (index.contains(candidate_points[i]))
         {
-            std::cerr << "Candidate " << get_steiner_point_method(i) << " failed: duplicate point\n";
+            LOG_TRACE("Candidate " << get_steiner_point_method(i) << " failed: duplicate point");
+            profile_count(COUNTER_REJECTED_DUPLICATE);
             continue;
         }
 
-        if (is_point_inside_constraints(candidate_points[i], constraints))
+        if (!region.contains(candidate_points[i]))
         {
-            std::cerr << "Candidate " << get_steiner_point_method(i) << " failed: outside constraints\n";
+            LOG_TRACE("Candidate " << get_steiner_point_method(i) << " failed: outside region");
+            profile_count(COUNTER_REJECTED_OUTSIDE);
             continue;
         }
 
-        contender ct;
-        ct.st_point = candidate_points[i];
-        ct.method = get_steiner_point_method(i);
-        ct.copy_cdt = cdt;
-        ct.copy_cdt.insert(candidate_points[i]);
+        // All candidates are close to the obtuse face, the walk starts there
+        start_faces[i] = cdt.locate(candidate_points[i], locate_types[i], locate_indices[i], edge.first);
+        located.push_back(i);
+    }
 
-        // Analyze obtuse angles in the new triangulation
-        for (CDT::Finite_faces_iterator face_it = ct.copy_cdt.finite_faces_begin(); face_it != ct.copy_cdt.finite_faces_end(); ++face_it)
-        {
-            Point_2 p1 = face_it->vertex(0)->point();
-            Point_2 p2 = face_it->vertex(1)->point();
-            Point_2 p3 = face_it->vertex(2)->point();
+    // Score the candidates over their conflict zones only, on the pool. The CDT is only read.
+    vector<contender> results(no_candidates);
+    vector<char> evaluated(no_candidates, 0);
+    pool.run(located.size(), [&](int k)
+             {
+        int i = located[k];
+        evaluated[i] = evaluate_candidate(cdt, score, candidate_points[i], start_faces[i], locate_types[i], locate_indices[i], results[i]); });
 
-            if (is_obtuse_triangle(p1, p2, p3))
-            {
-                ct.no_obtuse_faces++;
-                double angle1 = angle_between_points(p1, p2, p3);
-                double angle2 = angle_between_points(p2, p1, p3);
-                double angle3 = angle_between_points(p3, p1, p2);
-
-                // Sum of obtuse angles
-                if (angle1 > 90)
-                    ct.total_obtuse_angle_sum += angle1;
-                if (angle2 > 90)
-                    ct.total_obtuse_angle_sum += angle2;
-                if (angle3 > 90)
-                    ct.total_obtuse_angle_sum += angle3;
-
-                // Track maximum angle
-                ct.max_angle = std::max(ct.max_angle, std::max({angle1, angle2, angle3}));
-            }
+    // Collected in candidate order, so the choice below does not depend on thread timing
+    for (int i : located)
+    {
+        if (!evaluated[i])
+        {
+            LOG_TRACE("Candidate " << get_steiner_point_method(i) << " failed: no conflict zone");
+            profile_count(COUNTER_REJECTED_NO_CONFLICT_ZONE);
+            continue;
         }
-
-        // Calculate current CDT's penalty score
-        ct.cdt_penalty_score = (weight_obtuse_faces * ct.no_obtuse_faces) +
-                               (weight_max_angle * ct.max_angle) +
-                               (weight_total_obtuse_sum * ct.total_obtuse_angle_sum);
-
-        st_contenders.push_back(ct);
+        results[i].method = get_steiner_point_method(i);
+        st_contenders.push_back(results[i]);
     }
+    evaluate_scope.stop();
 
-    // Compare the contenders based on custom metrics
+    // Compare the contenders based on custom metrics, on a tie the earlier candidate wins
     if (!st_contenders.empty())
     {
         int best_contender_index = 0;
@@ -114,54 +100,63 @@ bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vecto
         }
 
         contender best_contender = st_contenders[best_contender_index];
-        cdt.insert(best_contender.st_point);
-        std::cout << "Best Steiner point added at: ("
+        inserted_vertex = insert_and_score(cdt, score, best_contender.st_point);
+        index.insert(inserted_vertex);
+        profile_count(COUNTER_STEINER_POINTS);
+        LOG_DEBUG("Best Steiner point added at: ("
                   << best_contender.st_point.x() << ", "
                   << best_contender.st_point.y() << ") with penalty score: "
-                  << best_contender.cdt_penalty_score << "\n";
+                  << best_contender.cdt_penalty_score);
         return true;
     }
 
-    std::cerr << "No Steiner points found that were valid, skipping insertion." << std::endl;
+    LOG_TRACE("No Steiner points found that were valid, skipping insertion.");
     return false;
 }
 
-bool attempt_to_flip(CDT &cdt, CDT::Finite_faces_iterator face_it, CDT::Edge edge)
+bool attempt_to_flip(CDT &cdt, CDT::Edge edge)
 {
-    CDT copied_cdt = cdt; // Create a copy of the CDT
+    profile_count(COUNTER_FLIPS_ATTEMPTED);
 
     // Ensure the edge has two distinct faces
     CDT::Face_handle face0 = edge.first;
     CDT::Face_handle face1 = face0->neighbor(edge.second);
     if (face1 == nullptr || face0 == nullptr || face0 == face1)
     {
-        std::cerr << "Error: Edge does not have two distinct valid faces for flipping... Extiting attempt_to_flip" << std::endl;
+        LOG_TRACE("Error: Edge does not have two distinct valid faces for flipping... Extiting attempt_to_flip");
         return false;
     }
 
     if (cdt.is_infinite(face0) || cdt.is_infinite(face1))
     {
-        std::cerr << "One of the faces is infinite." << std::endl;
+        LOG_TRACE("One of the faces is infinite.");
         return false; // Handle this case appropriately
     }
 
-    // Perform the edge flip in the copied CDT
-    copied_cdt.flip(face0, edge.second);
-    check_cdt_validity(cdt);
+    // Perform the edge flip in place, the transaction undoes it if it does not help
+    CDT::Vertex_handle va = face0->vertex(edge.second);
+    CDT::Vertex_handle vb = face1->vertex(cdt.mirror_index(face0, edge.second));
+    cdt_transaction trial(cdt);
+    trial.begin();
+    if (!trial.flip(face0, edge.second))
+    {
+        LOG_TRACE("Edge is constrained or its faces are not convex, cannot flip.");
+        return false;
+    }
 
-    // Check angles in the copied CDT
+    // Only the two faces around the new diagonal have changed
     bool all_acute = true;
-    for (CDT::Finite_faces_iterator fit = copied_cdt.finite_faces_begin(); fit != copied_cdt.finite_faces_end(); ++fit)
+    CDT::Face_handle new_face;
+    int i;
+    cdt.is_edge(va, vb, new_face, i);
+    CDT::Face_handle new_faces[2] = {new_face, new_face->neighbor(i)};
+    for (const auto &fit : new_faces)
     {
         Point_2 p1 = fit->vertex(0)->point();
         Point_2 p2 = fit->vertex(1)->point();
         Point_2 p3 = fit->vertex(2)->point();
 
-        double angle1 = angle_between_points(p1, p2, p3);
-        double angle2 = angle_between_points(p2, p1, p3);
-        double angle3 = angle_between_points(p3, p1, p2);
-
-        if (angle1 > 90 || angle2 > 90 || angle3 > 90)
+        if (is_obtuse_triangle(p1, p2, p3))
         {
             all_acute = false;
             break;
@@ -170,297 +165,318 @@ bool attempt_to_flip(CDT &cdt, CDT::Finite_faces_iterator face_it, CDT::Edge edg
 
     if (all_acute)
     {
-        cout << "Flipping Edge!!!" << endl;
-        cdt = copied_cdt; // Apply the flip if all angles are acute
+        LOG_DEBUG("Flipping Edge!!!");
+        trial.commit(); // Keep the flip if all angles are acute
         return true;
     }
     else
     {
-        std::cerr << "Flip resulted in non-acute angles, reverting changes." << std::endl;
-        return false; // Revert to the original CDT
+        LOG_TRACE("Flip resulted in non-acute angles, reverting changes.");
+        trial.rollback(); // Revert to the original CDT
+        return false;
     }
 }
 
-CDT triangulation(vector<Point_2> &points, vector<int> &region_boundary, const vector<pair<int, int>> &additional_constraints, ptree parameters)
+// Bulk insertion of points[i] for every i in indices, with info i. The indices are put in
+// Hilbert order (BRIO rounds) first, so every point is located with a short walk from the
+// vertex inserted before it. vertices[i] is the vertex of points[i] afterwards.
+void insert_points_sorted(CDT &cdt, const vector<Point_2> &points, vector<int> indices, vector<CDT::Vertex_handle> &vertices)
 {
-    // τριγωνοποίηση Delaunay
-    CDT cdt;
-    // No of iterations (Cicles) script will execute
-    int max_no_of_iterations = parameters.second.data();
+    typedef CGAL::Spatial_sort_traits_adapter_2<Kernel, CGAL::Pointer_property_map<Point_2>::const_type> Sort_traits;
+    CGAL::spatial_sort(indices.begin(), indices.end(), Sort_traits(CGAL::make_property_map(points)));
 
-    // Manually store the constraints as pairs of points
-    vector<std::pair<Point_2, Point_2>> constraints;
+    vertices.resize(points.size());
+    CDT::Face_handle hint;
+    for (int i : indices)
+    {
+        CDT::Vertex_handle vertex = cdt.insert(points[i], hint);
+        vertex->info() = i;
+        vertices[i] = vertex;
+        hint = vertex->face();
+    }
+}
 
-    cout << "Starting insertion of given points in PSLG" << endl;
-    // προσθήκη σημείων από τον vector points με έλεγχο των constraints
-    for (const auto &point : points)
+// Region boundary as a closed chain of constraints and then every additional constraint, all by the
+// vertices of insert_points_sorted. Indices that are out of range or whose point was not inserted
+// are skipped. constraints gets the end points of every constraint inserted.
+int insert_constraints(CDT &cdt, const vector<Point_2> &points, const vector<CDT::Vertex_handle> &vertices, const vector<int> &region_boundary,
+                       const vector<pair<int, int>> &additional_constraints, vector<pair<Point_2, Point_2>> &constraints)
+{
+    vector<pair<int, int>> segments;
+    segments.reserve(region_boundary.size() + additional_constraints.size());
+    for (size_t i = 0; region_boundary.size() > 2 && i < region_boundary.size(); i++)
+        segments.push_back({region_boundary[i], region_boundary[(i + 1) % region_boundary.size()]});
+    segments.insert(segments.end(), additional_constraints.begin(), additional_constraints.end());
+
+    int inserted = 0, skipped = 0;
+    for (const auto &segment : segments)
     {
-        // Check if the point is inside the constraints
-        if (is_point_inside_constraints(point, constraints))
+        int a = segment.first, b = segment.second;
+        if (a < 0 || b < 0 || a >= (int)vertices.size() || b >= (int)vertices.size() ||
+            vertices[a] == nullptr || vertices[b] == nullptr || vertices[a] == vertices[b])
         {
-            cdt.insert(point); // εισαγωγή σημείου στην τριγωνοποίηση
-            check_cdt_validity(cdt);
-        }
-        else
-        {
-            std::cerr << "Point (" << point.x() << ", " << point.y() << ") is outside constraints and will be skipped.\n";
+            skipped++;
+            continue;
         }
+        cdt.insert_constraint(vertices[a], vertices[b]);
+        constraints.push_back({points[a], points[b]});
+        inserted++;
     }
+    if (skipped > 0)
+        LOG_WARN(skipped << " constraints refer to points that are not in the triangulation and were skipped.");
+    LOG_INFO("Constraints inserted: " << inserted << "  Constrained edges: " << cdt.number_of_subconstraints());
+    return inserted;
+}
 
-    // προσθήκη περιορισμένων ακμών (PSLG)
-    // Ensure region boundary constraints are added in CCW order
-    // for (std::size_t i = 0; i < region_boundary.size() - 1; ++i)
-    // {
-    //     Point_2 p1 = points[region_boundary[i]];
-    //     Point_2 p2 = points[region_boundary[i + 1]];
-    //     cdt.insert_constraint(p1, p2);
-    //     constraints.push_back({p1, p2}); // Store the region boundary constraint
-    // }
-
-    // // Close the loop for region_boundary if needed
-    // if (!region_boundary.empty() && region_boundary.size() > 2)
-    // {
-    //     Point_2 p1 = points[region_boundary.back()];
-    //     Point_2 p2 = points[region_boundary.front()];
-    //     cdt.insert_constraint(p1, p2);
-    //     constraints.push_back({p1, p2}); // Store the closing constraint
-    // }
-    // else if (region_boundary.empty())
-    // {
-    //     cerr << "Warning: region_boundary is empty. No loop will be closed." << endl;
-    // }
-
-    // // Add additional constraints
-    // if (!additional_constraints.empty())
-    // {
-    //     for (const auto &constraint : additional_constraints)
-    //     {
-    //         Point_2 p1 = points[constraint.first];
-    //         Point_2 p2 = points[constraint.second];
-    //         cdt.insert_constraint(p1, p2);
-    //         constraints.push_back({p1, p2}); // Store the additional constraint
-    //     }
-    // }
-    // else
-    // {
-    //     cerr << "Warning: additional_constraints is empty. No constraints will be added." << endl;
-    // }
+// Constraints of a resumed run. The checkpoint has the constrained edges as the Steiner points split
+// them, every edge is a constraint of its own. These are taken out and the input constraints go back
+// in from end to end, through the Steiner points on them, so the hierarchy and constraints are the
+// same as in a run that did not stop.
+int reinsert_input_constraints(CDT &cdt, const vector<Point_2> &points, const vector<int> &region_boundary,
+                               const vector<pair<int, int>> &additional_constraints, vector<pair<Point_2, Point_2>> &constraints)
+{
+    vector<CDT::Constraint_id> restored(cdt.constraints_begin(), cdt.constraints_end());
+    for (const auto &constraint : restored)
+        cdt.remove_constraint(constraint);
 
-    check_cdt_validity(cdt);
+    // The vertex info is the input index, as after the bulk insertion
+    vector<CDT::Vertex_handle> vertices(points.size());
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        if (vit->info() >= 0 && vit->info() < (int)points.size())
+            vertices[vit->info()] = vit;
+    }
+    constraints.clear();
+    return insert_constraints(cdt, points, vertices, region_boundary, additional_constraints, constraints);
+}
 
+// Worklist refinement: the worst obtuse face is refined first and only the faces created by an
+// insertion are examined again. The run is anytime: when it stops (budget, deadline or signal) the
+// mesh is the best one it went through. A caller that changed the mesh just before passes its record
+// as earlier, the run then continues it and can fall back past that change as well. A caller that knows
+// where the obtuse faces are passes them as seeded, only those are queued instead of the whole mesh.
+// Returns the number of Steiner points added, less the ones the fall back removed.
+int refine_local(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                 task_pool &pool, int max_steiner_points, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint,
+                 best_solution *earlier, obtuse_worklist *seeded)
+{
     // επανάληψη για προσθήκη σημείων Steiner αν υπάρχουν αμβλυγώνια τρίγωνα
-    bool all_acute = false;
-    bool steiner_point_inserted;
-    bool steiner_point_added_this_rotation;
-    int no_of_steiner_points_added = 0;
+    // Every obtuse face is queued once, after that only the faces created by an insertion are examined
+    obtuse_worklist own_worklist;
+    obtuse_worklist &worklist = seeded != nullptr ? *seeded : own_worklist;
+    if (seeded == nullptr)
+        worklist.push_all_faces(cdt);
+    LOG_INFO("Number of faces: " << cdt.number_of_faces() << "  Obtuse faces queued: " << worklist.size());
 
-    while (!all_acute && no_of_steiner_points_added < max_no_of_iterations)
+    int no_of_steiner_points_added = 0;
+    CDT::Face_handle face;
+    int obtuse_index;
+    best_solution own;
+    best_solution &best = earlier != nullptr ? *earlier : own;
+    if (earlier == nullptr)
+        best.start(score);
+
+    while (no_of_steiner_points_added < max_steiner_points && worklist.pop(cdt, face, obtuse_index))
     {
-        // Visualize the triangulation
-        // export_to_svg(cdt, "output.svg");
-        all_acute = true; // υποθετω ολα τα τριγωνα οξυγωνια
-        cout << endl
-             << "Starting to check angles... again" << endl;
-
-        int face_count = cdt.number_of_faces();
-        cout << "Number of faces: " << face_count << endl;
+        if (should_stop(deadline))
+        {
+            LOG_INFO((cancelled() ? "Stop requested" : "Time limit reached") << " after " << no_of_steiner_points_added << " Steiner points");
+            break;
+        }
 
-        for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); face_it++)
+        // The edge opposite to the obtuse angle is the one that gets refined
+        CDT::Vertex_handle new_vertex;
+        if (!add_steiner_point_local_search(cdt, CDT::Edge(face, obtuse_index), constraints, region, score, index, pool, new_vertex))
         {
-            steiner_point_added_this_rotation = false;
-            if (!face_it->is_valid())
-            {
-                std::cerr << "Invalid face detected, skipping." << endl;
-                continue; // Skip invalid faces
-            }
+            profile_count(COUNTER_WASTED_STEPS);
+            continue; // The face is dropped, it gets queued again only if a later insertion rebuilds it
+        }
 
-            Point_2 p1 = face_it->vertex(0)->point();
-            Point_2 p2 = face_it->vertex(1)->point();
-            Point_2 p3 = face_it->vertex(2)->point();
+        no_of_steiner_points_added++;
+        best.add(new_vertex, score);
+        worklist.push_incident_faces(cdt, new_vertex);
 
-            cout << "P1:" << p1 << "  P2:" << p2 << "  P3:" << p3 << endl;
+        LOG_DEBUG("No. of Steiner Points: " << no_of_steiner_points_added
+                  << "  Faces re-examined: " << worklist.faces_examined
+                  << "  Obtuse faces queued: " << worklist.size()
+                  << "  Penalty score: " << score.penalty());
+        profile_count(COUNTER_FACES_SCANNED, worklist.faces_examined);
+        worklist.faces_examined = 0;
 
-            // Υπολογισμός των γωνιών του τριγώνου
-            double angle1 = angle_between_points(p1, p2, p3);
-            double angle2 = angle_between_points(p2, p1, p3);
-            double angle3 = angle_between_points(p3, p1, p2);
+        if (checkpoint != nullptr && checkpoint->due())
+            checkpoint->write(cdt);
+    }
+    profile_count(COUNTER_FACES_SCANNED, worklist.faces_examined);
+    no_of_steiner_points_added -= best.restore(cdt, score, index, constraints);
 
-            cout << "Angle1:" << angle1 << "  Angle2:" << angle2 << "  Angle3:" << angle3 << endl;
+    if (worklist.empty())
+        LOG_INFO("All faces/triangles are acute");
+    LOG_INFO("Steiner points: " << no_of_steiner_points_added << "  Penalty score: " << score.penalty());
+    return no_of_steiner_points_added;
+}
 
-            if (angle1 == 0 || angle2 == 0 || angle3 == 0)
-            {
-                cout << "Angle = 0 Found !!!!" << endl;
-                continue;
-            }
+// Flip pass: the edge opposite to the obtuse angle of every obtuse face is flipped if both new faces
+// are acute (attempt_to_flip). The faces are collected first, a flip destroys the faces around it.
+int flip_obtuse_faces(CDT &cdt)
+{
+    vector<std::array<CDT::Vertex_handle, 4>> obtuse_faces; // The three vertices, then the obtuse one
+    for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); face_it++)
+    {
+        int worst = obtuse_vertex(face_it->vertex(0)->point(), face_it->vertex(1)->point(), face_it->vertex(2)->point());
+        if (worst >= 0)
+            obtuse_faces.push_back({face_it->vertex(0), face_it->vertex(1), face_it->vertex(2), face_it->vertex(worst)});
+    }
 
-            // if (angle1 > 90 || angle2 > 90 || angle3 > 90)
-            // {
-            //     all_acute = false;
-            //     bool flipped = false;
+    int flips = 0;
+    for (const auto &vertices : obtuse_faces)
+    {
+        CDT::Face_handle face;
+        if (!cdt.is_face(vertices[0], vertices[1], vertices[2], face))
+            continue;
+        if (attempt_to_flip(cdt, CDT::Edge(face, face->index(vertices[3]))))
+            flips++;
+    }
+    LOG_INFO("Flip pass: " << flips << " of " << obtuse_faces.size() << " obtuse faces flipped");
+    return flips;
+}
 
-            //     // Try to flip the edges in the order of angles, fallback to Steiner point if flipping fails
-            //     if (angle1 > 90)
-            //         flipped = attempt_to_flip(cdt, face_it, CDT::Edge(face_it, 2));
+// Threads a method may use for key: key itself, else "threads", else one per core. Batch mode sets
+// "threads" to the share of the cores of each instance.
+int thread_parameter(const ptree &parameters, const string &key)
+{
+    int threads = parameters.get<int>(key, 0);
+    if (threads <= 0)
+        threads = parameters.get<int>("threads", 0);
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    return threads;
+}
 
-            //     if (!flipped && angle2 > 90)
-            //         flipped = attempt_to_flip(cdt, face_it, CDT::Edge(face_it, 0));
+// Refine the mesh with one method. The method parameters can set the penalty weights and
+// flips_first, a flip pass before the refinement.
+void refine_mesh(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                 const string &method, ptree parameters, int max_steiner_points, std::chrono::steady_clock::time_point deadline,
+                 checkpoint_writer *checkpoint)
+{
+    score.weights.read(parameters);
+    if (parameters.get<bool>("flips_first", false) && flip_obtuse_faces(cdt) > 0)
+        score.rebuild(cdt);
 
-            //     if (!flipped && angle3 > 90)
-            //         flipped = attempt_to_flip(cdt, face_it, CDT::Edge(face_it, 1));
+    if (method == "sa")
+    {
+        simulated_annealing(cdt, constraints, region, score, index, parameters, deadline, checkpoint);
+    }
+    else if (method == "ant")
+    {
+        ant_colony(cdt, constraints, region, score, index, parameters, deadline, checkpoint);
+    }
+    else if (method == "tiles")
+    {
+        tiled_refinement(cdt, constraints, region, score, index, parameters, deadline, checkpoint);
+    }
+    else
+    {
+        // Threads for the candidate evaluation
+        task_pool pool(thread_parameter(parameters, "candidate_threads"));
+        refine_local(cdt, constraints, region, score, index, pool, max_steiner_points, deadline, checkpoint);
+        LOG_INFO("Duplicate candidates: " << index.hits << " of " << (index.hits + index.misses));
+    }
+}
 
-            //     if (!flipped) // If flipping fails, add a Steiner point
-            //     {
+CDT triangulation(vector<Point_2> &points, vector<int> &region_boundary, const vector<pair<int, int>> &additional_constraints, const string &method, ptree parameters,
+                  std::chrono::steady_clock::time_point deadline)
+{
+    // τριγωνοποίηση Delaunay
+    CDT cdt;
+    // No of iterations (Cicles) script will execute
+    int max_no_of_iterations = parameters.get<int>("L", 1000);
 
-            if (angle1 > 90)
-            {
-                all_acute = false;
-                bool flipped = false;
-                steiner_point_inserted = add_steiner_point_local_search(cdt, CDT::Edge(face_it, 0), constraints);
-                if (steiner_point_inserted) // steiner point hasn't been skipped
-                {
-                    no_of_steiner_points_added++;
-                    cout << "No. of Steiner Points: " << no_of_steiner_points_added << endl;
-                    face_it = cdt.finite_faces_begin();
-                    steiner_point_added_this_rotation = true;
-                    break; // Steiner Point has been added... Now Restart the checking of angles
-                }
-            }
-            else if (angle2 > 90)
+    // Manually store the constraints as pairs of points
+    vector<std::pair<Point_2, Point_2>> constraints;
+
+    // The region polygon is built and checked once, every point and candidate is tested against it
+    region_index region;
+    region.build(points, region_boundary);
+
+    // Resume: the mesh of the checkpoint replaces the input points, the input constraints are put back on it
+    string resume = parameters.get<string>("resume", "");
+    if (!resume.empty() && read_checkpoint(resume, cdt))
+    {
+        int steiner_points = 0;
+        for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+        {
+            if (vit->info() < 0)
+                steiner_points++;
+        }
+        max_no_of_iterations = std::max(0, max_no_of_iterations - steiner_points); // L counts the Steiner points of the whole run
+
+        profile_scope constraints_scope(PHASE_INSERT_CONSTRAINTS);
+        if (parameters.get<bool>("constraints", true))
+            reinsert_input_constraints(cdt, points, region_boundary, additional_constraints, constraints);
+    }
+    else
+    {
+        LOG_INFO("Starting insertion of given points in PSLG");
+        // προσθήκη σημείων από τον vector points με έλεγχο του region
+        profile_scope insert_scope(PHASE_INSERT_POINTS);
+        vector<int8_t> inside;
+        region.contains(points, inside);
+        int no_outside = 0;
+        vector<int> indices;
+        indices.reserve(points.size());
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            if (inside[i])
             {
-                all_acute = false;
-                bool flipped = false;
-                steiner_point_inserted = add_steiner_point_local_search(cdt, CDT::Edge(face_it, 1), constraints);
-                if (steiner_point_inserted) // steiner point hasn't been skipped
-                {
-                    no_of_steiner_points_added++;
-                    cout << "No. of Steiner Points: " << no_of_steiner_points_added << endl;
-                    face_it = cdt.finite_faces_begin();
-                    steiner_point_added_this_rotation = true;
-                    break;
-                }
+                indices.push_back(i);
             }
-            else if (angle3 > 90)
+            else
             {
-                all_acute = false;
-                bool flipped = false;
-                steiner_point_inserted = add_steiner_point_local_search(cdt, CDT::Edge(face_it, 2), constraints);
-                if (steiner_point_inserted) // steiner point hasn't been skipped
-                {
-                    no_of_steiner_points_added++;
-                    cout << "No. of Steiner Points: " << no_of_steiner_points_added << endl;
-                    face_it = cdt.finite_faces_begin();
-                    steiner_point_added_this_rotation = true;
-                    break;
-                }
+                LOG_DEBUG("Point (" << points[i].x() << ", " << points[i].y() << ") is outside the region and will be skipped.");
+                no_outside++;
             }
-            // }
-            // }
-        }
-        if (steiner_point_added_this_rotation == false) // Will need to add flip if it was working
-        {
-            cout << "All faces/triangles are acute" << endl;
-            all_acute = true; // If the loop ever ends it means that all faces are acute
         }
+        if (no_outside > 0)
+            LOG_WARN(no_outside << " points are outside the region and were skipped.");
+        // εισαγωγή σημείων στην τριγωνοποίηση, all at once in spatial order
+        vector<CDT::Vertex_handle> vertices;
+        insert_points_sorted(cdt, points, indices, vertices);
+        insert_scope.stop();
+
+        // προσθήκη περιορισμένων ακμών (PSLG)
+        profile_scope constraints_scope(PHASE_INSERT_CONSTRAINTS);
+        // The boundary and the additional constraints go in by the vertex handles of the bulk
+        // insertion, no point is located again
+        if (parameters.get<bool>("constraints", true))
+            insert_constraints(cdt, points, vertices, region_boundary, additional_constraints, constraints);
+        constraints_scope.stop();
     }
 
-    return cdt;
-}
+    check_cdt_validity(cdt);
 
-// double calculate_energy(const CDT &cdt, double alpha, double beta)
-// {
-//     int obtuse_count = 0;
-//     int steiner_count = 0;
-
-//     // Count obtuse triangles
-//     for (auto fit = cdt.finite_faces_begin(); fit != cdt.finite_faces_end(); ++fit)
-//     {
-//         Point_2 p1 = fit->vertex(0)->point();
-//         Point_2 p2 = fit->vertex(1)->point();
-//         Point_2 p3 = fit->vertex(2)->point();
-
-//         // Compute the squared edge lengths
-//         double a2 = CGAL::squared_distance(p2, p3);
-//         double b2 = CGAL::squared_distance(p1, p3);
-//         double c2 = CGAL::squared_distance(p1, p2);
-
-//         // ελεγχος για αμβλυα γωνια
-//         if (a2 > b2 + c2 || b2 > a2 + c2 || c2 > a2 + b2)
-//             obtuse_count++;
-//     }
-
-//     // υπολογισμος Steiner points
-//     for (auto vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); ++vit)
-//     {
-//         if (vit->info().is_steiner)
-//         {
-//             steiner_count++;
-//         }
-//     }
-
-//     // τπος υπολογισμου ενεργειας απο δοαφανειες μαθηματος
-//     double energy = alpha * obtuse_count + beta * steiner_count;
-//     return energy;
-// }
-
-// // προσομοιωμενη ανόπτηση
-// void simulated_annealing(Triangulation &triangulation, double alpha, double beta, int max_iterations)
-// {
-//     double T = 1.0;         // αρχικη θερμοκρασια
-//     int L = max_iterations; // αριθμος επαναληψεων
-
-//     // Define random number generation for Steiner options
-//     std::random_device rd;
-//     std::mt19937 gen(rd());
-//     std::uniform_int_distribution<int> dist(0, 4); // 5 Steiner point options
-
-//     while (T > 0)
-//     {
-//         for (auto &triangle : triangulation.triangles)
-//         {
-//             // Check if the triangle is obtuse dynamically
-//             auto vertices = triangle.get_vertices();
-//             Point a = vertices[0], b = vertices[1], c = vertices[2];
-//             double a2 = CGAL::squared_distance(b, c);
-//             double b2 = CGAL::squared_distance(a, c);
-//             double c2 = CGAL::squared_distance(a, b);
-
-//             // Determine if the triangle is obtuse
-//             if (a2 > b2 + c2 || b2 > a2 + c2 || c2 > a2 + b2)
-//             {
-//                 // Generate a random Steiner point location (pseudo-code)
-//                 Point steiner_option = {/* Random point */};
-
-//                 // Store the current triangulation as a backup
-//                 Triangulation backup = triangulation;
-
-//                 // Store the current energy before insertion
-//                 double initial_energy = calculate_energy(triangulation, alpha, beta);
-
-//                 // Insert Steiner point
-//                 // add_steiner_point_local_search(triangulation, steiner_option);
-//                 bool insertion_succesful) = add_steiner_point_local_search(triangulation, steiner_option);
-
-//                 // Calculate new energy
-//                 if (insertion_succesful)
-//                 {
-//                     double new_energy = calculate_energy(triangulation, alpha, beta);
-//                     double delta_energy = new_energy - initial_energy;
-
-//                     // Accept or reject the new configuration
-//                     if (delta_energy < 0 || exp(-delta_energy / T) > ((double)rand() / RAND_MAX))
-//                     {
-//                         // Accept new configuration
-//                         continue;
-//                     }
-//                     else
-//                     {
-//                         // Reject and restore the previous state
-//                         triangulation = backup;
-//                     }
-//                 }
-//             }
-//         }
-//         // Decrease temperature
-//         T -= 1.0 / L;
-//     }
-// }
\ No newline at end of file
+    // Global penalty terms, the candidates are scored as a delta against these
+    mesh_score score;
+    score.rebuild(cdt);
+
+    // Position of every vertex, the Steiner candidates are checked for duplicates against it
+    vertex_index index;
+    index.rebuild(cdt);
+
+    // Periodic snapshots of the refinement (main --checkpoint), the last one is written when it ends
+    checkpoint_writer checkpoint;
+    checkpoint.filename = parameters.get<string>("checkpoint", "");
+    checkpoint.interval = parameters.get<double>("checkpoint_interval", 60);
+
+    profile_scope refine_scope(PHASE_REFINE);
+    if (method == "portfolio" && !checkpoint.filename.empty())
+        LOG_WARN("The portfolio runs on copies of the mesh, only the final mesh is written to " << checkpoint.filename);
+    if (method == "portfolio")
+        portfolio_refinement(cdt, constraints, region, score, index, parameters, max_no_of_iterations, deadline);
+    else
+        refine_mesh(cdt, constraints, region, score, index, method, parameters, max_no_of_iterations, deadline, &checkpoint);
+    refine_scope.stop();
+
+    if (!checkpoint.filename.empty())
+        checkpoint.write(cdt);
+    return cdt;
+}
\ No newline at end of file
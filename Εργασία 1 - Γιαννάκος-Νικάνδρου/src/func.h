@@ -6,6 +6,88 @@
 #include <iostream>
 #include <cmath>
 #include <sstream>
+#include <queue>
+#include <set>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <random>
+
+// Memory for the triangulation data structure. CGAL's Compact_container already takes its vertices
+// and faces from blocks, one allocator call per block; with the arena those blocks come from 2 MB
+// slabs and are recycled by size class, so the trial copies of a CDT stop going through malloc.
+// Every thread has its own arena, a block can be freed on any thread.
+class memory_arena
+{
+public:
+    static const int no_size_classes = 16; // 64 bytes to 2 MB, larger blocks go to malloc
+
+    void *allocate(size_t bytes);
+    static void deallocate(void *pointer);
+    bool release();
+    void retire();
+
+private:
+    std::mutex mutex;
+    std::vector<std::pair<void *, bool>> slabs; // Slab and whether it is mmap'ed
+    char *next = nullptr, *end = nullptr;        // Free part of the last slab
+    void *free_blocks[no_size_classes] = {};     // One linked list per size class
+    long live = 0;                               // Blocks handed out and not freed yet
+    bool retired = false;                        // The thread of the arena has exited
+
+    void free_block(void *block, int size_class);
+    void release_slabs();
+};
+
+// Allocator counts, for the benchmarks. System allocations are the calls that reached malloc or mmap.
+class arena_statistics
+{
+public:
+    long allocations = 0;
+    long reused = 0;
+    long system_allocations = 0;
+    long bytes_reserved = 0;
+};
+
+extern std::atomic<bool> arena_enabled;    // Off: every block goes to malloc (still counted)
+extern std::atomic<bool> arena_huge_pages; // Ask for transparent huge pages for the slabs (Linux)
+void *arena_allocate(size_t bytes);
+void arena_deallocate(void *pointer) noexcept;
+bool arena_release();
+arena_statistics arena_stats();
+
+template <class T>
+class arena_allocator
+{
+public:
+    typedef T value_type;
+    template <class U>
+    struct rebind
+    {
+        typedef arena_allocator<U> other;
+    };
+
+    arena_allocator() noexcept {}
+    template <class U>
+    arena_allocator(const arena_allocator<U> &) noexcept {}
+
+    T *allocate(size_t n) { return static_cast<T *>(arena_allocate(n * sizeof(T))); }
+    void deallocate(T *pointer, size_t) noexcept { arena_deallocate(pointer); }
+};
+
+template <class T, class U>
+bool operator==(const arena_allocator<T> &, const arena_allocator<U> &) { return true; }
+template <class T, class U>
+bool operator!=(const arena_allocator<T> &, const arena_allocator<U> &) { return false; }
+
+// Picked up by the Compact_container of every Triangulation_data_structure_2
+#define CGAL_ALLOCATOR(T) arena_allocator<T>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
@@ -15,26 +97,44 @@
 #include <CGAL/Delaunay_triangulation_2.h>
 #include <CGAL/Constrained_Delaunay_triangulation_2.h>
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 #include <CGAL/triangulation_assertions.h>
-#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Triangulation_vertex_base_with_info_2.h>
 #include <CGAL/Constrained_triangulation_plus_2.h>
 #include <CGAL/centroid.h>
+#include <CGAL/spatial_sort.h>
+#include <CGAL/Spatial_sort_traits_adapter_2.h>
+#include <CGAL/property_map.h>
 #include <CGAL/Kernel/global_functions.h>
 
 using namespace boost::property_tree;
 
+// Geometry kernel, chosen at build time (make KERNEL=simple_cartesian|epick|epeck):
+// Simple_cartesian<double> is fastest but its predicates can fail on near-degenerate input,
+// epick has exact predicates on double coordinates, epeck also constructs points exactly.
+#if defined(KERNEL_EPECK)
+using Kernel = CGAL::Exact_predicates_exact_constructions_kernel;
+#define KERNEL_NAME "epeck"
+#elif defined(KERNEL_EPICK)
+using Kernel = CGAL::Exact_predicates_inexact_constructions_kernel;
+#define KERNEL_NAME "epick"
+#else
 using Kernel = CGAL::Simple_cartesian<double>;
+#define KERNEL_NAME "simple_cartesian"
+#endif
 using Point_2 = Kernel::Point_2;
 using Polygon_2 = CGAL::Polygon_2<Kernel>;
 using Segment_2 = Kernel::Segment_2;
 
-using CDT = CGAL::Constrained_Delaunay_triangulation_2<Kernel>;
-
 // contstraint delaunay triangulation
+// Vertex info: index of the input point, -1 for Steiner points
 typedef CGAL::Triangulation_vertex_base_with_info_2<int, Kernel> Vb;
 typedef CGAL::Constrained_triangulation_face_base_2<Kernel> Fb;
 typedef CGAL::Triangulation_data_structure_2<Vb, Fb> Tds;
+typedef CGAL::Constrained_Delaunay_triangulation_2<Kernel, Tds> CDT_base;
+// Constraint hierarchy on top: every constraint keeps the list of vertices on it, so a Steiner
+// point that splits a constrained edge is tracked without searching for the original segment
+using CDT = CGAL::Constrained_triangulation_plus_2<CDT_base>;
 typedef CDT::Vertex_handle Vertex_handle;
 typedef CDT::Edge Edge;
 typedef CGAL::Polygon_2<Kernel> Polygon_2;
@@ -46,6 +146,55 @@ const double weight_obtuse_faces = 10.0;
 const double weight_max_angle = 5.0;
 const double weight_total_obtuse_sum = 2.0;
 
+// Log levels. Levels above LOG_LEVEL (set by the makefile) are compiled out, arguments included,
+// so the debug and trace lines of the refinement loop cost nothing in a release build.
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+#define LOG_LEVEL_TRACE 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Usage: LOG_INFO("Faces: " << cdt.number_of_faces()); one call is one line
+#define LOG_AT(level, message)                                      \
+    do                                                              \
+    {                                                               \
+        if (log_level.load(std::memory_order_relaxed) >= (level))   \
+        {                                                           \
+            std::ostringstream log_line;                            \
+            log_line << message << '\n';                            \
+            log_output().write(level, log_line.str());              \
+        }                                                           \
+    } while (0)
+#define LOG_NOTHING() \
+    do                \
+    {                 \
+    } while (0)
+
+#define LOG_ERROR(message) LOG_AT(LOG_LEVEL_ERROR, message)
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(message) LOG_AT(LOG_LEVEL_WARN, message)
+#else
+#define LOG_WARN(message) LOG_NOTHING()
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(message) LOG_AT(LOG_LEVEL_INFO, message)
+#else
+#define LOG_INFO(message) LOG_NOTHING()
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(message) LOG_AT(LOG_LEVEL_DEBUG, message)
+#else
+#define LOG_DEBUG(message) LOG_NOTHING()
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE(message) LOG_AT(LOG_LEVEL_TRACE, message)
+#else
+#define LOG_TRACE(message) LOG_NOTHING()
+#endif
+
 class contender
 {
 public:
@@ -55,32 +204,538 @@ public:
     double max_angle = 0;              // Maximum angle after insertion
     double total_obtuse_angle_sum = 0; // Sum of all obtuse angles
     double cdt_penalty_score = 0;      // Rating of new CDT (the lower the better)
-    CDT copy_cdt;                      // CDT after inserting the contender
+    int conflict_faces = 0;            // Faces the insertion would destroy
+};
+
+// Penalty terms of a single face
+class face_score
+{
+public:
+    bool obtuse = false;
+    double max_angle = 0;        // Largest angle of the face
+    double obtuse_angle_sum = 0; // Sum of its obtuse angles
+};
+
+// Weights of the penalty terms, the constants above unless the method parameters set
+// weight_obtuse_faces, weight_max_angle or weight_total_obtuse_sum
+class penalty_weights
+{
+public:
+    double obtuse_faces = weight_obtuse_faces;
+    double max_angle = weight_max_angle;
+    double total_obtuse_sum = weight_total_obtuse_sum;
+
+    void read(const ptree &parameters);
+    double penalty(int no_obtuse_faces, double largest_angle, double total_obtuse_angle_sum) const;
+};
+
+// Penalty terms of the whole CDT, kept up to date with every insertion
+class mesh_score
+{
+public:
+    penalty_weights weights;
+    int no_obtuse_faces = 0;                 // Total number of faces with obtuse angles
+    double total_obtuse_angle_sum = 0;       // Sum of all obtuse angles
+    std::multiset<double> obtuse_max_angles; // Largest angle of every obtuse face
+
+    void add_face(const face_score &fs);
+    void remove_face(const face_score &fs);
+    void rebuild(const CDT &cdt);
+    double max_angle() const;
+    double max_angle_after(const vector<face_score> &removed, const vector<face_score> &added) const;
+    double penalty() const;
+};
+
+// Obtuse face waiting in the worklist, the face is identified by its vertices
+// since face handles do not survive the insertions around them
+class obtuse_face
+{
+public:
+    double worst_cosine = 0;          // Cosine of the obtuse angle, the lower the worse
+    CDT::Vertex_handle vertices[3];   // Vertices of the face when it was queued
+    CDT::Vertex_handle obtuse_vertex; // Vertex with the obtuse angle
+
+    bool operator<(const obtuse_face &other) const { return worst_cosine > other.worst_cosine; }
+};
+
+// Priority queue of the obtuse faces, worst angle first
+class obtuse_worklist
+{
+public:
+    int faces_examined = 0; // Faces (re)examined since the last insertion
+
+    bool push_face(const CDT &cdt, CDT::Face_handle face);
+    int push_all_faces(const CDT &cdt);
+    int push_incident_faces(const CDT &cdt, CDT::Vertex_handle vertex);
+    bool pop(const CDT &cdt, CDT::Face_handle &face, int &obtuse_index);
+    bool empty() const { return queue.empty(); }
+    size_t size() const { return queue.size(); }
+
+private:
+    std::priority_queue<obtuse_face> queue;
+};
+
+// Obtuse faces for random sampling (simulated annealing), faces are checked lazily when drawn
+class obtuse_sampler
+{
+public:
+    void push_face(const CDT &cdt, CDT::Face_handle face);
+    void push_all_faces(const CDT &cdt);
+    void push_incident_faces(const CDT &cdt, CDT::Vertex_handle vertex);
+    bool sample(const CDT &cdt, std::mt19937 &gen, CDT::Face_handle &face, int &obtuse_index);
+    size_t size() const { return faces.size(); }
+
+private:
+    vector<std::array<CDT::Vertex_handle, 3>> faces;
+};
+
+// Pheromone of every Steiner point method on a coarse grid over the mesh (ant colony)
+class pheromone_table
+{
+public:
+    vector<std::array<double, 5>> tau; // tau[cell][method]
+
+    void reset(const CDT &cdt, int regions_per_axis);
+    int region_of(const Point_2 &point) const;
+
+private:
+    int regions = 1;
+    double min_x = 0, min_y = 0, max_x = 1, max_y = 1;
+};
+
+// Mesh built by one ant in one cycle and the choices it made
+class ant_result
+{
+public:
+    CDT cdt;          // Copied from the colony's mesh once, an ant's moves are rolled back after every cycle
+    mesh_score score; // Of cdt
+    int steiner_points = 0;
+    double energy = 0;
+    vector<pair<int, int>> choices; // (cell, method) of every insertion
+    vector<Point_2> points;         // Every insertion, replayed on the colony's mesh when the ant wins
+};
+
+// Triangles stored as coordinate arrays (structure of arrays) for the batched predicates
+class triangle_batch
+{
+public:
+    vector<double> ax, ay, bx, by, cx, cy;
+
+    void push_back(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
+    void reserve(size_t n);
+    void clear();
+    size_t size() const { return ax.size(); }
+};
+
+// Hash index of the CDT vertices by position, replaces the linear scan for duplicate points.
+// It has to be kept in sync with every insertion and removal on the CDT.
+class vertex_index
+{
+public:
+    long hits = 0;   // Lookups that found an existing vertex
+    long misses = 0; // Lookups that did not
+
+    void rebuild(const CDT &cdt);
+    void insert(CDT::Vertex_handle vertex);
+    void remove(const Point_2 &point);
+    CDT::Vertex_handle find(const Point_2 &point) const;
+    bool contains(const Point_2 &point);
+    size_t size() const { return vertices.size(); }
+
+private:
+    struct point_hash
+    {
+        size_t operator()(const Point_2 &p) const;
+    };
+    std::unordered_map<Point_2, CDT::Vertex_handle, point_hash> vertices;
+};
+
+// Membership test for the region_boundary polygon. The polygon is built and checked once,
+// its edges are bucketed into a uniform grid and the inside/outside state of every cell
+// center is precomputed, so a query only looks at the edges of one cell.
+class region_index
+{
+public:
+    bool build(const vector<Point_2> &points, const vector<int> &region_boundary);
+    bool contains(const Point_2 &point) const;
+    void contains(const vector<Point_2> &points, vector<int8_t> &inside) const;
+    void clip(double min_x, double min_y, double max_x, double max_y);
+    bool is_valid() const { return valid; }
+
+private:
+    Polygon_2 polygon;
+    bool valid = false;
+    bool clipped = false;
+    double clip_min_x = 0, clip_min_y = 0, clip_max_x = 0, clip_max_y = 0; // Open box, see clip()
+    double min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    double cell_width = 0, cell_height = 0;
+    int columns = 0, rows = 0;
+    vector<int> cell_start;    // Edges of cell i are cell_edges[cell_start[i] .. cell_start[i + 1])
+    vector<int> cell_edges;    // Edge e goes from polygon[e] to polygon[e + 1]
+    vector<int8_t> cell_state; // Cell center: 1 inside, 0 outside, -1 on (or too close to) the boundary
+
+    int column_of(double x) const;
+    int row_of(double y) const;
+};
+
+// One change in the undo log of a cdt_transaction
+class undo_record
+{
+public:
+    bool is_flip = false;
+    CDT::Vertex_handle a, b;                           // Flip: the new diagonal
+    CDT::Vertex_handle vertex;                         // Insertion: the new vertex
+    vector<std::array<CDT::Vertex_handle, 3>> old_faces; // Insertion: faces it destroyed
+};
+
+// Speculative changes on a CDT (flips and insertions) that can be undone in O(change)
+// instead of working on a copy of the whole triangulation
+class cdt_transaction
+{
+public:
+    cdt_transaction(CDT &cdt, mesh_score *score = nullptr, vertex_index *index = nullptr);
+
+    void begin();
+    void commit();
+    void rollback();
+    bool flip(CDT::Face_handle face, int i);
+    CDT::Vertex_handle insert(const Point_2 &point);
+    bool is_flippable(CDT::Face_handle face, int i) const;
+    size_t size() const { return undo_log.size(); }
+
+private:
+    CDT &cdt;
+    mesh_score *score;   // Kept in sync with the CDT when given
+    vertex_index *index; // Kept in sync with the CDT when given
+    vector<undo_record> undo_log;
+    bool open = false;
+
+    bool undo_flip(const undo_record &record);
+    bool undo_insert(const undo_record &record);
+    bool force_edge(CDT::Vertex_handle a, CDT::Vertex_handle b);
+    bool first_crossing(CDT::Vertex_handle a, CDT::Vertex_handle b, CDT::Face_handle &face, int &i);
+    void add_faces_of_edge(CDT::Vertex_handle a, CDT::Vertex_handle b);
+};
+
+// Fixed set of worker threads for small parallel loops (the candidates of one insertion),
+// kept alive between calls so that a loop costs a wake-up and not a thread start
+class task_pool
+{
+public:
+    task_pool(int threads);
+    ~task_pool();
+
+    void run(int tasks, const std::function<void(int)> &task);
+    int size() const { return workers.size() + 1; }
+
+private:
+    vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const std::function<void(int)> *job = nullptr;
+    int job_tasks = 0;
+    std::atomic<int> next_task{0};
+    int active = 0;      // Workers still busy with the current job
+    long generation = 0; // Incremented for every job
+    bool stop = false;
+    std::exception_ptr error;
+
+    void work();
+    void worker_loop();
+};
+
+// Start of a binary instance file (binary_io.cpp), the offsets are from the start of the file
+class binary_instance_header
+{
+public:
+    char magic[8];
+    uint32_t version = 1;
+    uint32_t delaunay = 0;
+    uint64_t num_points = 0, num_boundary = 0, num_constraints = 0;
+    int64_t num_constraints_field = 0; // "num_constraints" of the JSON file
+    uint64_t points_offset = 0, boundary_offset = 0, constraints_offset = 0;
+    uint64_t uid_offset = 0, uid_size = 0, method_offset = 0, method_size = 0, parameters_offset = 0, parameters_size = 0;
+    uint64_t file_size = 0;
+};
+
+// Writes a checkpoint of the refinement every interval seconds (checkpoint.cpp has the format)
+class checkpoint_writer
+{
+public:
+    string filename; // Empty: no checkpoints
+    double interval = 60;
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+
+    bool due() const;
+    bool write(const CDT &cdt);
+};
+
+// Best mesh of an anytime refinement: fewest obtuse faces, then fewest Steiner points.
+// The refinements only add Steiner points, so the best mesh has the points of the start mesh plus a
+// prefix of the committed insertions. Only the handles are recorded, restore cuts the mesh back to that
+// prefix and keeps the mesh it started from when the cut mesh turns out worse (see restore).
+class best_solution
+{
+public:
+    int no_obtuse_faces = -1;          // Of the best mesh, -1 before start
+    size_t prefix = 0;                 // Insertions the best mesh has
+    vector<CDT::Vertex_handle> added;  // Committed Steiner points, in order
+
+    void start(const mesh_score &score);
+    void record(CDT::Vertex_handle vertex);
+    void offer(const mesh_score &score);
+    void add(CDT::Vertex_handle vertex, const mesh_score &score);
+    int restore(CDT &cdt, mesh_score &score, vertex_index &index, const vector<pair<Point_2, Point_2>> &constraints);
+};
+
+// Cancellation and progress of one run of a portfolio. The thread of the run points current_control
+// at it: should_stop also honours cancel, best_solution publishes the best mesh of the run so far.
+class run_control
+{
+public:
+    std::atomic<bool> cancel{false};
+    std::atomic<int> no_obtuse_faces{-1};     // Best mesh so far, -1 until the refinement starts
+    std::atomic<int> best_steiner_points{0};  // Steiner points the run added up to its best mesh
+    std::atomic<int> steiner_points{0};       // Steiner points the run has added so far
+};
+
+// One configuration of a portfolio and the mesh it refines
+class portfolio_run
+{
+public:
+    string method;
+    ptree parameters;           // The portfolio parameters with the configuration on top
+    int max_steiner_points = 0; // L of the local search
+    CDT cdt;
+    run_control control;
+    std::chrono::steady_clock::time_point start; // Set before started, the referee reads it after
+    std::atomic<bool> started{false};
+    std::atomic<bool> done{false};
+    int no_obtuse_faces = 0; // Of the final mesh
+    int steiner_points = 0;
+    double seconds = 0;
+};
+
+// One row of the batch summary
+class batch_result
+{
+public:
+    string instance;        // File name without extension
+    string status;          // ok, time_limit, interrupted, skipped, killed, read_error, error or crashed
+    int steiner_points = 0; // Steiner points in the solution
+    int obtuse_faces = 0;   // Obtuse faces left
+    double wall_time = 0;   // Seconds, reading and writing included
+    double peak_rss = 0;    // MB, peak resident set size of the child process of the instance
+};
+
+// Phases and counters of one run (run_profile), the names are in profile.cpp
+enum profile_phase
+{
+    PHASE_READ,
+    PHASE_INSERT_POINTS,
+    PHASE_INSERT_CONSTRAINTS,
+    PHASE_REFINE,
+    PHASE_EVALUATE_CANDIDATES, // Part of PHASE_REFINE
+    PHASE_WRITE_SOLUTION,
+    PHASE_EXPORT_SVG,
+    PHASE_CHECKPOINT, // Writing and reading checkpoints
+    PHASE_COUNT
+};
+
+enum profile_counter
+{
+    COUNTER_FACES_SCANNED,
+    COUNTER_CANDIDATES,
+    COUNTER_REJECTED_DUPLICATE,
+    COUNTER_REJECTED_OUTSIDE,
+    COUNTER_REJECTED_NO_CONFLICT_ZONE,
+    COUNTER_CDT_COPIES,
+    COUNTER_FLIPS_ATTEMPTED,
+    COUNTER_STEINER_POINTS,
+    COUNTER_WASTED_STEPS, // Refinement steps that inserted nothing
+    COUNTER_COUNT
+};
+
+// Time per phase and event counts of one run. The run points current_profile (one per thread) at it,
+// without a profile the scopes and counters below only test a null pointer.
+class run_profile
+{
+public:
+    double seconds[PHASE_COUNT] = {}; // Wall time spent in each phase
+    long calls[PHASE_COUNT] = {};     // Times each phase was entered
+    long counters[COUNTER_COUNT] = {};
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    bool write_json(const string &filename, const string &instance_uid) const;
+};
+
+extern thread_local run_profile *current_profile;
+
+inline void profile_count(profile_counter counter, long n = 1)
+{
+    if (current_profile != nullptr)
+        current_profile->counters[counter] += n;
+}
+
+// Adds the time from construction to destruction to a phase of the current profile
+class profile_scope
+{
+public:
+    profile_scope(profile_phase phase) : phase(phase), profile(current_profile)
+    {
+        if (profile != nullptr)
+            start = std::chrono::steady_clock::now();
+    }
+    ~profile_scope() { stop(); }
+
+    // Ends the phase before the end of the scope
+    void stop()
+    {
+        if (profile == nullptr)
+            return;
+        profile->seconds[phase] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        profile->calls[phase]++;
+        profile = nullptr;
+    }
+
+private:
+    profile_phase phase;
+    run_profile *profile;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Destination of the log lines, shared by all threads. Info and below go to stdout through a
+// buffer that is written out when it fills up or gets old, warnings and errors go to stderr at once.
+class log_sink
+{
+public:
+    void write(int level, const string &line);
+    void flush();
+    ~log_sink() { flush(); }
+
+private:
+    std::mutex mutex;
+    string buffer;
+    std::chrono::steady_clock::time_point last_flush = std::chrono::steady_clock::now();
+
+    void flush_locked();
 };
 
 // export.cpp
 void export_to_svg(const CDT &cdt, const std::string &filename);
 
 // trianglulation.cpp
-CDT triangulation(vector<Point_2> &points, vector<int> &region_boundary, const vector<pair<int, int>> &additional_constraints, ptree parameters);
-bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vector<pair<Point_2, Point_2>> &constraints);
-bool attempt_to_flip(CDT &cdt, CDT::Finite_faces_iterator face_it, CDT::Edge edge);
-double calculate_energy(const CDT &cdt, double alpha, double beta);
+CDT triangulation(vector<Point_2> &points, vector<int> &region_boundary, const vector<pair<int, int>> &additional_constraints, const string &method, ptree parameters,
+                  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+bool add_steiner_point_local_search(CDT &cdt, const CDT::Edge &edge, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index, task_pool &pool, CDT::Vertex_handle &inserted_vertex);
+bool attempt_to_flip(CDT &cdt, CDT::Edge edge);
+void insert_points_sorted(CDT &cdt, const vector<Point_2> &points, vector<int> indices, vector<CDT::Vertex_handle> &vertices);
+int insert_constraints(CDT &cdt, const vector<Point_2> &points, const vector<CDT::Vertex_handle> &vertices, const vector<int> &region_boundary,
+                       const vector<pair<int, int>> &additional_constraints, vector<pair<Point_2, Point_2>> &constraints);
+int reinsert_input_constraints(CDT &cdt, const vector<Point_2> &points, const vector<int> &region_boundary,
+                               const vector<pair<int, int>> &additional_constraints, vector<pair<Point_2, Point_2>> &constraints);
+int refine_local(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                 task_pool &pool, int max_steiner_points, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint = nullptr,
+                 best_solution *earlier = nullptr, obtuse_worklist *seeded = nullptr);
+int flip_obtuse_faces(CDT &cdt);
+int thread_parameter(const ptree &parameters, const string &key);
+void refine_mesh(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                 const string &method, ptree parameters, int max_steiner_points, std::chrono::steady_clock::time_point deadline,
+                 checkpoint_writer *checkpoint = nullptr);
+
+// sa.cpp
+void simulated_annealing(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                         ptree parameters, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint = nullptr);
+
+// ant.cpp
+void ant_colony(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                ptree parameters, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint = nullptr);
+
+// tiles.cpp
+void tiled_refinement(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                      ptree parameters, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint = nullptr);
+
+// anytime.cpp
+extern std::atomic<bool> stop_requested; // Set by SIGINT and SIGTERM, the refinements stop at their next step
+extern thread_local run_control *current_control;
+void install_stop_handlers();
+bool cancelled();
+bool should_stop(std::chrono::steady_clock::time_point deadline);
+bool should_stop(std::chrono::steady_clock::time_point deadline, const run_control *control);
+std::chrono::steady_clock::time_point deadline_after(double seconds);
+
+// transaction.cpp
+void remove_steiner_point(CDT &cdt, CDT::Vertex_handle vertex);
+
+// portfolio.cpp
+void portfolio_refinement(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                          ptree parameters, int max_steiner_points, std::chrono::steady_clock::time_point deadline);
+
+// checkpoint.cpp
+bool write_checkpoint(const string &filename, const CDT &cdt);
+bool read_checkpoint(const string &filename, CDT &cdt);
+
+// predicates.cpp
+int obtuse_vertex(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
+double angle_cosine(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
+bool is_degenerate_triangle(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
+void classify_obtuse_batch(const triangle_batch &batch, vector<int8_t> &obtuse);
+void classify_obtuse_batch_scalar(const triangle_batch &batch, vector<int8_t> &obtuse);
+
+// score.cpp
+face_score score_face(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
+face_score score_face(const CDT::Face_handle &face);
+void score_faces(const triangle_batch &batch, vector<face_score> &scores);
+bool get_conflict_zone(const CDT &cdt, const Point_2 &point, vector<CDT::Face_handle> &zone, vector<CDT::Edge> &boundary);
+bool get_conflict_zone(const CDT &cdt, const Point_2 &point, CDT::Face_handle start, CDT::Locate_type lt, int li,
+                       vector<CDT::Face_handle> &zone, vector<CDT::Edge> &boundary);
+bool evaluate_candidate(const CDT &cdt, const mesh_score &score, const Point_2 &point, contender &ct);
+bool evaluate_candidate(const CDT &cdt, const mesh_score &score, const Point_2 &point, CDT::Face_handle start, CDT::Locate_type lt, int li, contender &ct);
+CDT::Vertex_handle insert_and_score(CDT &cdt, mesh_score &score, const Point_2 &point);
 
 // common.cpp
 double angle_between_points(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
 bool is_obtuse_triangle(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3);
 void check_cdt_validity(const CDT &cdt);
+void constraint_end_points(const CDT &cdt, vector<pair<Point_2, Point_2>> &constraints);
+bool check_constraints(const CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints);
 bool is_point_inside_constraints(const Point_2 &point, const vector<pair<Point_2, Point_2>> &constraints);
 void analyze_obtuse_angles(const CDT &cdt);
+int count_obtuse_faces(const CDT &cdt);
 Point_2 mean_point_of_adjacent_triangles(CDT &cdt, CDT::Face_handle face, const vector<pair<Point_2, Point_2>> &constraints);
 Point_2 project_point_on_segment(const Point_2 &p, const Segment_2 &s);
 bool point_exists_in_cdt(const Point_2 &point, const CDT &cdt);
 string get_steiner_point_method(int i);
+Point_2 get_steiner_point(CDT &cdt, const CDT::Edge &edge, const vector<pair<Point_2, Point_2>> &constraints, int i);
+
+// batch.cpp
+int run_batch(const string &input, const string &output_dir, int threads, double time_limit, const string &summary_file, bool profile = false,
+              double checkpoint_interval = 0, bool resume = false, const string &executable = "main");
+int run_batch_instance(const string &file_path, const string &output_dir, const string &result_file, double time_limit, int threads,
+                       bool profile, double checkpoint_interval, bool resume);
+
+// profile.cpp
+const char *profile_counter_name(profile_counter counter);
+string profile_file_name(const string &solution_file);
+
+// log.cpp
+extern std::atomic<int> log_level; // Run time level, only lowers what LOG_LEVEL compiled in
+log_sink &log_output();
 
 // io.c
 bool read_json_file(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints, vector<pair<int, int>> &additional_constraints,
                     string &method, ptree &parameters, bool &delaunay);
-void create_json_output(const CDT &cdt, const std::string &filename);
+bool read_json_file_ptree(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints, vector<pair<int, int>> &additional_constraints,
+                          string &method, ptree &parameters, bool &delaunay);
+void create_json_output(CDT &cdt, const string &instance_uid, int num_points, const std::string &filename);
+
+// binary_io.cpp
+bool is_binary_instance_file(const string &file_path);
+bool write_binary_instance(const string &file_path, const string &instance_uid, const vector<Point_2> &points, const vector<int> &region_boundary, int num_constraints,
+                           const vector<pair<int, int>> &additional_constraints, const string &method, const ptree &parameters, bool delaunay);
+bool read_binary_instance(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints,
+                          vector<pair<int, int>> &additional_constraints, string &method, ptree &parameters, bool &delaunay);
+bool read_instance_file(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints,
+                        vector<pair<int, int>> &additional_constraints, string &method, ptree &parameters, bool &delaunay);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,267 @@
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <algorithm>
+#include <unordered_set>
+#include "./func.h"
+
+// Synthetic instances in the read_json_file format, for scaling tests.
+// Usage: gen <category> <num_points> <output.json> [--constraints n] [--seed s] [--range r] [--method m]
+// category: simple_polygon, simple_polygon_with_exterior, ortho, point-set
+
+class instance_builder
+{
+public:
+    vector<Point_2> points;
+    vector<int> region_boundary;
+
+    instance_builder(long range) : range(range) {}
+
+    // Adds the point unless it is already there, returns its index or -1
+    int add(long x, long y)
+    {
+        if (!used.insert(x * (range + 1) + y).second)
+            return -1;
+        points.emplace_back(x, y);
+        return points.size() - 1;
+    }
+
+    long range; // Coordinates are in [0, range]
+
+private:
+    std::unordered_set<long> used;
+};
+
+// Star shaped polygon around the center of the square, always simple.
+// With deep notches every other vertex goes near the center, so a large part of the
+// convex hull is exterior to the region (the _with_exterior instances).
+static void star_boundary(instance_builder &instance, int m, bool deep_notches, std::mt19937 &gen)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    double center = instance.range / 2.0;
+    for (int i = 0; i < m; i++)
+    {
+        double angle = 2 * M_PI * (i + 0.8 * unit(gen)) / m;
+        double r = deep_notches && i % 2 == 1 ? 0.15 + 0.3 * unit(gen) : 0.6 + 0.4 * unit(gen);
+        int index = instance.add(std::lround(center + r * center * std::cos(angle)), std::lround(center + r * center * std::sin(angle)));
+        if (index >= 0)
+            instance.region_boundary.push_back(index); // Dropping a vertex keeps the polygon star shaped
+    }
+}
+
+// Points drawn uniformly from the bounding square and kept if they are inside the region
+static void fill_region(instance_builder &instance, int n, std::mt19937 &gen)
+{
+    region_index region;
+    region.build(instance.points, instance.region_boundary);
+    std::uniform_int_distribution<long> coord(0, instance.range);
+    while ((int)instance.points.size() < n)
+    {
+        long x = coord(gen), y = coord(gen);
+        if (region.contains(Point_2(x, y)))
+            instance.add(x, y);
+    }
+}
+
+// Orthogonal polygon: a histogram of k columns with distinct neighbouring heights.
+// Interior points are drawn strictly inside a column, so they never land on the boundary.
+static void ortho_instance(instance_builder &instance, int n, std::mt19937 &gen)
+{
+    int k = std::max(1, std::min(n / 8, 500));
+    long width = instance.range / k;
+    std::uniform_int_distribution<long> height(instance.range / 4, instance.range);
+    vector<long> heights(k);
+    for (int i = 0; i < k; i++)
+    {
+        do
+            heights[i] = height(gen);
+        while (i > 0 && heights[i] == heights[i - 1]);
+    }
+
+    auto &boundary = instance.region_boundary;
+    boundary.push_back(instance.add(0, 0));
+    boundary.push_back(instance.add(k * width, 0));
+    for (int i = k - 1; i >= 0; i--)
+    {
+        boundary.push_back(instance.add((i + 1) * width, heights[i]));
+        boundary.push_back(instance.add(i * width, heights[i]));
+    }
+
+    std::uniform_int_distribution<int> column(0, k - 1);
+    std::uniform_real_distribution<double> unit(0, 1);
+    while ((int)instance.points.size() < n)
+    {
+        int i = column(gen);
+        if (unit(gen) * instance.range > heights[i])
+            continue; // Columns are picked in proportion to their area
+        std::uniform_int_distribution<long> x(i * width + 1, (i + 1) * width - 1), y(1, heights[i] - 1);
+        instance.add(x(gen), y(gen));
+    }
+}
+
+// Random points, the region is their convex hull (monotone chain, collinear points left out)
+static void point_set_instance(instance_builder &instance, int n, std::mt19937 &gen)
+{
+    std::uniform_int_distribution<long> coord(0, instance.range);
+    while ((int)instance.points.size() < n)
+        instance.add(coord(gen), coord(gen));
+
+    const vector<Point_2> &points = instance.points;
+    vector<int> order(points.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b)
+              { return points[a] < points[b]; });
+
+    auto left_turn = [&](int a, int b, int c)
+    { return CGAL::orientation(points[a], points[b], points[c]) == CGAL::LEFT_TURN; };
+    vector<int> hull(2 * order.size());
+    int h = 0;
+    for (int i : order) // Lower half
+    {
+        while (h >= 2 && !left_turn(hull[h - 2], hull[h - 1], i))
+            h--;
+        hull[h++] = i;
+    }
+    for (int j = order.size() - 2, lower = h + 1; j >= 0; j--) // Upper half
+    {
+        while (h >= lower && !left_turn(hull[h - 2], hull[h - 1], order[j]))
+            h--;
+        hull[h++] = order[j];
+    }
+    hull.resize(h - 1); // The first point closes the chain
+    instance.region_boundary = hull;
+}
+
+// Up to count edges of the constrained Delaunay triangulation inside the region.
+// Edges of one triangulation never cross and never pass through another point.
+static vector<pair<int, int>> random_constraints(const instance_builder &instance, int count, std::mt19937 &gen)
+{
+    vector<pair<int, int>> constraints;
+    if (count <= 0)
+        return constraints;
+
+    CDT cdt;
+    for (size_t i = 0; i < instance.points.size(); i++)
+        cdt.insert(instance.points[i])->info() = i;
+    const vector<int> &boundary = instance.region_boundary;
+    for (size_t i = 0; i < boundary.size(); i++)
+        cdt.insert_constraint(instance.points[boundary[i]], instance.points[boundary[(i + 1) % boundary.size()]]);
+
+    region_index region;
+    region.build(instance.points, boundary);
+    for (CDT::Finite_edges_iterator edge = cdt.finite_edges_begin(); edge != cdt.finite_edges_end(); ++edge)
+    {
+        if (cdt.is_constrained(*edge))
+            continue;
+        CDT::Vertex_handle a = edge->first->vertex(cdt.ccw(edge->second));
+        CDT::Vertex_handle b = edge->first->vertex(cdt.cw(edge->second));
+        if (region.contains(CGAL::midpoint(a->point(), b->point())))
+            constraints.push_back({a->info(), b->info()});
+    }
+
+    std::shuffle(constraints.begin(), constraints.end(), gen);
+    if ((int)constraints.size() < count)
+        cerr << "Only " << constraints.size() << " constraints fit, asked for " << count << endl;
+    else
+        constraints.resize(count);
+    return constraints;
+}
+
+static bool write_instance(const string &filename, const string &instance_uid, const instance_builder &instance,
+                           const vector<pair<int, int>> &constraints, const string &method)
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return false;
+    }
+
+    out << "{\n  \"instance_uid\": \"" << instance_uid << "\",\n  \"num_points\": " << instance.points.size() << ",\n  \"points_x\": [";
+    for (size_t i = 0; i < instance.points.size(); i++)
+        out << (i ? ", " : "") << std::lround(CGAL::to_double(instance.points[i].x()));
+    out << "],\n  \"points_y\": [";
+    for (size_t i = 0; i < instance.points.size(); i++)
+        out << (i ? ", " : "") << std::lround(CGAL::to_double(instance.points[i].y()));
+    out << "],\n  \"region_boundary\": [";
+    for (size_t i = 0; i < instance.region_boundary.size(); i++)
+        out << (i ? ", " : "") << instance.region_boundary[i];
+    out << "],\n  \"num_constraints\": " << constraints.size() << ",\n  \"additional_constraints\": [";
+    for (size_t i = 0; i < constraints.size(); i++)
+        out << (i ? ", " : "") << "[" << constraints[i].first << ", " << constraints[i].second << "]";
+
+    // Parameters for every method, so only "method" has to change to try another one
+    out << "],\n  \"method\": \"" << method << "\",\n"
+        << "  \"parameters_local\": {\"L\": 1000},\n"
+        << "  \"parameters_sa\": {\"alpha\": 2.0, \"beta\": 0.2, \"L\": 1000},\n"
+        << "  \"parameters_ant\": {\"alpha\": 2.0, \"beta\": 0.2, \"xi\": 1.0, \"psi\": 3.0, \"lambda\": 0.5, \"kappa\": 10, \"L\": 50},\n"
+        << "  \"parameters_tiles\": {\"tiles\": 0, \"margin\": 0.1, \"L\": 1000},\n"
+        << "  \"parameters_portfolio\": {\"L\": 1000, \"grace\": 2.0, \"dominance\": 0.5, \"configurations\": ["
+        << "{\"method\": \"local\"}, {\"method\": \"local\", \"weight_obtuse_faces\": 20, \"weight_max_angle\": 1, \"weight_total_obtuse_sum\": 0.5}, "
+        << "{\"method\": \"local\", \"flips_first\": true}, {\"method\": \"sa\", \"alpha\": 2.0, \"beta\": 0.2}]},\n"
+        << "  \"delaunay\": true\n}\n";
+    return bool(out);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        cerr << "Usage: " << argv[0] << " <simple_polygon|simple_polygon_with_exterior|ortho|point-set> <num_points> <output.json>"
+             << " [--constraints n] [--seed s] [--range r] [--method local|sa|ant|tiles|portfolio]" << endl;
+        return 1;
+    }
+    string category = argv[1];
+    int n = std::stoi(argv[2]);
+    string filename = argv[3];
+    int num_constraints = 0;
+    unsigned seed = 1;
+    long range = 1000000;
+    string method = "local";
+    for (int i = 4; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        if (option == "--constraints")
+            num_constraints = std::stoi(argv[i + 1]);
+        else if (option == "--seed")
+            seed = std::stoul(argv[i + 1]);
+        else if (option == "--range")
+            range = std::stol(argv[i + 1]);
+        else if (option == "--method")
+            method = argv[i + 1];
+        else
+            cerr << "Unknown option " << option << endl;
+    }
+    if (n < 8 || range < 1000 || (long)n > (range + 1) * (range + 1) / 2)
+    {
+        cerr << "Need at least 8 points, a range of at least 1000 and room for the points in it" << endl;
+        return 1;
+    }
+
+    std::mt19937 gen(seed);
+    instance_builder instance(range);
+    int m = std::max(3, std::min(n / 8, 1000)); // Boundary vertices of the star polygons
+    if (category == "simple_polygon" || category == "simple_polygon_with_exterior")
+    {
+        star_boundary(instance, m, category == "simple_polygon_with_exterior", gen);
+        fill_region(instance, n, gen);
+    }
+    else if (category == "ortho")
+        ortho_instance(instance, n, gen);
+    else if (category == "point-set")
+        point_set_instance(instance, n, gen);
+    else
+    {
+        cerr << "Unknown category " << category << endl;
+        return 1;
+    }
+
+    vector<pair<int, int>> constraints = random_constraints(instance, num_constraints, gen);
+    string instance_uid = category + "_" + std::to_string(n) + "_" + std::to_string(seed);
+    if (!write_instance(filename, instance_uid, instance, constraints, method))
+        return 1;
+    cout << instance_uid << ": " << instance.points.size() << " points, " << instance.region_boundary.size()
+         << " boundary vertices, " << constraints.size() << " constraints" << endl;
+    return 0;
+}
\ No newline at end of file
@@ -1,7 +1,268 @@
 #include "./func.h"
 #include <iostream>
+#include <fstream>
+#include <charconv>
+#include <map>
+#include <algorithm>
+
+// Streaming reader for the instance files. The file is read into one buffer and the
+// arrays are parsed straight into the output vectors, no ptree node per element.
+
+static void skip_whitespace(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        p++;
+}
+
+static bool expect(const char *&p, const char *end, char c)
+{
+    skip_whitespace(p, end);
+    if (p == end || *p != c)
+        return false;
+    p++;
+    return true;
+}
+
+static bool parse_string(const char *&p, const char *end, string &out)
+{
+    if (!expect(p, end, '"'))
+        return false;
+    out.clear();
+    while (p < end && *p != '"')
+    {
+        if (*p == '\\' && p + 1 < end)
+            p++; // Escaped character, kept as is
+        out.push_back(*p++);
+    }
+    if (p == end)
+        return false;
+    p++;
+    return true;
+}
+
+template <class T>
+static bool parse_number(const char *&p, const char *end, T &value)
+{
+    skip_whitespace(p, end);
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc())
+        return false;
+    p = result.ptr;
+    return true;
+}
+
+// Skip any JSON value, nested objects and arrays included
+static bool skip_value(const char *&p, const char *end)
+{
+    skip_whitespace(p, end);
+    if (p == end)
+        return false;
+    if (*p == '"')
+    {
+        string ignored;
+        return parse_string(p, end, ignored);
+    }
+    if (*p != '{' && *p != '[')
+    {
+        while (p < end && *p != ',' && *p != '}' && *p != ']')
+            p++;
+        return true;
+    }
+
+    int depth = 0;
+    while (p < end)
+    {
+        if (*p == '"')
+        {
+            string ignored;
+            if (!parse_string(p, end, ignored))
+                return false;
+            continue;
+        }
+        if (*p == '{' || *p == '[')
+            depth++;
+        else if (*p == '}' || *p == ']')
+        {
+            if (--depth == 0)
+            {
+                p++;
+                return true;
+            }
+        }
+        p++;
+    }
+    return false;
+}
+
+// Flat array of numbers, the vector is reserved from the number of commas first
+template <class T>
+static bool parse_number_array(const char *&p, const char *end, vector<T> &values)
+{
+    if (!expect(p, end, '['))
+        return false;
+    const char *close = std::find(p, end, ']');
+    values.reserve(values.size() + std::count(p, close, ',') + 1);
+
+    skip_whitespace(p, end);
+    if (p < end && *p == ']')
+        return ++p, true;
+    while (true)
+    {
+        T value;
+        if (!parse_number(p, end, value))
+            return false;
+        values.push_back(value);
+        skip_whitespace(p, end);
+        if (p < end && *p == ',')
+            p++;
+        else
+            return expect(p, end, ']');
+    }
+}
+
+// Array of [a, b] index pairs
+static bool parse_pair_array(const char *&p, const char *end, vector<pair<int, int>> &pairs)
+{
+    skip_whitespace(p, end);
+    const char *close = p;
+    if (!skip_value(close, end))
+        return false;
+    pairs.reserve(pairs.size() + std::count(p + 1, close, '['));
+    if (!expect(p, end, '['))
+        return false;
+
+    skip_whitespace(p, end);
+    if (p < end && *p == ']')
+        return ++p, true;
+    while (true)
+    {
+        int first, second;
+        if (!expect(p, end, '[') || !parse_number(p, end, first) || !expect(p, end, ',') ||
+            !parse_number(p, end, second) || !expect(p, end, ']'))
+            return false;
+        pairs.emplace_back(first, second);
+        skip_whitespace(p, end);
+        if (p < end && *p == ',')
+            p++;
+        else
+            return expect(p, end, ']');
+    }
+}
 
 bool read_json_file(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints, vector<pair<int, int>> &additional_constraints, string &method, ptree &parameters, bool &delaunay)
+{
+    std::ifstream input_file(file_path, std::ios::binary);
+    if (!input_file)
+    {
+        LOG_ERROR("Error parsing JSON file: cannot open " << file_path);
+        return false;
+    }
+    string buffer;
+    input_file.seekg(0, std::ios::end);
+    buffer.resize(input_file.tellg());
+    input_file.seekg(0);
+    input_file.read(&buffer[0], buffer.size());
+
+    const char *p = buffer.data();
+    const char *end = p + buffer.size();
+
+    // The parameters block is only located here, it is parsed once the method is known
+    vector<double> points_x, points_y;
+    std::map<string, pair<size_t, size_t>> parameter_blocks;
+    std::set<string> found;
+    bool ok = expect(p, end, '{');
+    skip_whitespace(p, end);
+    if (ok && p < end && *p == '}')
+        p++;
+    else
+    {
+        while (ok)
+        {
+            string key;
+            ok = parse_string(p, end, key) && expect(p, end, ':');
+            if (!ok)
+                break;
+            skip_whitespace(p, end);
+            found.insert(key);
+
+            if (key == "instance_uid")
+                ok = parse_string(p, end, instance_uid);
+            else if (key == "method")
+                ok = parse_string(p, end, method);
+            else if (key == "points_x")
+                ok = parse_number_array(p, end, points_x);
+            else if (key == "points_y")
+                ok = parse_number_array(p, end, points_y);
+            else if (key == "region_boundary")
+                ok = parse_number_array(p, end, region_boundary);
+            else if (key == "additional_constraints")
+                ok = parse_pair_array(p, end, additional_constraints);
+            else if (key == "num_constraints")
+                ok = parse_number(p, end, num_constraints);
+            else if (key == "delaunay")
+            {
+                delaunay = end - p >= 4 && string(p, 4) == "true";
+                ok = skip_value(p, end);
+            }
+            else
+            {
+                const char *start = p;
+                ok = skip_value(p, end);
+                if (key.compare(0, 11, "parameters_") == 0)
+                    parameter_blocks[key] = {start - buffer.data(), p - start};
+            }
+
+            if (ok && expect(p, end, ','))
+                continue;
+            ok = ok && expect(p, end, '}');
+            break;
+        }
+    }
+    if (!ok)
+    {
+        LOG_ERROR("Error parsing JSON file: unexpected input at byte " << (p - buffer.data()));
+        return false;
+    }
+
+    for (const char *key : {"instance_uid", "points_x", "points_y", "region_boundary", "num_constraints", "additional_constraints", "method", "delaunay"})
+    {
+        if (found.count(key) == 0)
+        {
+            LOG_ERROR("Error parsing JSON file: no \"" << key << "\" field.");
+            return false;
+        }
+    }
+    if (points_x.size() != points_y.size())
+        LOG_WARN("Warning: points_x and points_y have different lengths.");
+
+    points.reserve(points.size() + std::min(points_x.size(), points_y.size()));
+    for (size_t i = 0; i < points_x.size() && i < points_y.size(); i++)
+        points.emplace_back(points_x[i], points_y[i]);
+
+    // Load parameters specific to the chosen method, this small block still goes through ptree
+    string parameters_key = "parameters_" + method;
+    auto block = parameter_blocks.find(parameters_key);
+    if (block == parameter_blocks.end())
+    {
+        LOG_ERROR("Error: Parameters for method \"" << method << "\" not found in JSON file.");
+        return false;
+    }
+    try
+    {
+        std::istringstream block_stream(buffer.substr(block->second.first, block->second.second));
+        read_json(block_stream, parameters);
+    }
+    catch (const json_parser_error &err)
+    {
+        LOG_ERROR("Error parsing JSON file: " << err.what());
+        return false;
+    }
+
+    return true;
+}
+
+// Reader that loads the whole file into a ptree, kept for comparison in the benchmark
+bool read_json_file_ptree(const string &file_path, string &instance_uid, vector<Point_2> &points, vector<int> &region_boundary, int &num_constraints, vector<pair<int, int>> &additional_constraints, string &method, ptree &parameters, bool &delaunay)
 {
     ptree pt;
     try
@@ -10,7 +271,7 @@ bool read_json_file(const string &file_path, string &instance_uid, vector<Point_
     }
     catch (const json_parser_error &err)
     {
-        cerr << "Error parsing JSON file: " << err.what() << endl;
+        LOG_ERROR("Error parsing JSON file: " << err.what());
         return false;
     }
 
@@ -52,7 +313,7 @@ bool read_json_file(const string &file_path, string &instance_uid, vector<Point_
     }
     else
     {
-        cerr << "Error: Parameters for method \"" << method << "\" not found in JSON file." << endl;
+        LOG_ERROR("Error: Parameters for method \"" << method << "\" not found in JSON file.");
         return false;
     }
 
@@ -61,69 +322,116 @@ bool read_json_file(const string &file_path, string &instance_uid, vector<Point_
     return true;
 }
 
-// Function to create JSON output from the CDT and save it to a file
-void create_json_output(const CDT &cdt, const std::string &filename)
+// Output through a large buffer, numbers are formatted in place with to_chars
+class json_sink
 {
-    using boost::property_tree::ptree;
-    ptree json_output;
+public:
+    json_sink(std::ofstream &out) : out(out), buffer(1 << 20), used(0) {}
+    ~json_sink() { flush(); }
 
-    // Set static fields
-    json_output.put("content_type", "CG_SHOP_2025_Solution");
-    json_output.put("instance_uid", "unique_instance_id");
-
-    // Create arrays for steiner_points_x and steiner_points_y
-    ptree steiner_points_x, steiner_points_y;
-    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    void write(const char *text, size_t length)
     {
-        ptree x, y;
-        x.put("", vit->point().x());
-        y.put("", vit->point().y());
-
-        steiner_points_x.push_back(std::make_pair("", x));
-        steiner_points_y.push_back(std::make_pair("", y));
+        if (used + length > buffer.size())
+            flush();
+        if (length > buffer.size())
+            out.write(text, length);
+        else
+        {
+            std::copy(text, text + length, buffer.data() + used);
+            used += length;
+        }
     }
+    void write(const string &text) { write(text.data(), text.size()); }
 
-    json_output.add_child("steiner_points_x", steiner_points_x);
-    json_output.add_child("steiner_points_y", steiner_points_y);
+    template <class T>
+    void number(T value)
+    {
+        if (used + 32 > buffer.size())
+            flush();
+        auto result = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+        used = result.ptr - buffer.data();
+    }
 
-    // Create edges array
-    ptree edges;
-    for (CDT::Finite_edges_iterator edge_it = cdt.finite_edges_begin(); edge_it != cdt.finite_edges_end(); edge_it++)
+    void flush()
     {
-        ptree edge_array;
+        out.write(buffer.data(), used);
+        used = 0;
+    }
 
-        // CDT::Edge e1 = edges.first->vertex(cdt.ccw(edge_it->second)); // First vertex of the edge
-        // CDT::Edge e2 = edges.first->vertex(cdt.cw(edge_it->second));  // Second vertex of the edge
-        // edge_array.push_back(std::make_pair("", )); // Assume 'info' provides a unique index
-        // edge_array.push_back(std::make_pair("", ));
+private:
+    std::ofstream &out;
+    vector<char> buffer;
+    size_t used;
+};
 
-        // Get the vertices of the edge
-        CDT::Vertex_handle v1 = edge_it->first->vertex(cdt.ccw(edge_it->second));
-        CDT::Vertex_handle v2 = edge_it->first->vertex(cdt.cw(edge_it->second));
+// Function to create JSON output from the CDT and save it to a file.
+// Only the Steiner points are written, the edges refer to vertices by index: the input points
+// keep their index (vertex info) and the Steiner points follow from num_points on. The output index
+// of a Steiner point is kept in its info while the file is written and set back to -1 afterwards.
+void create_json_output(CDT &cdt, const string &instance_uid, int num_points, const std::string &filename)
+{
+    std::ofstream output_file(filename, std::ios::binary);
+    if (!output_file.is_open())
+    {
+        LOG_ERROR("Error opening file: " << filename);
+        return;
+    }
+    json_sink sink(output_file);
 
-        // Access the points of the vertices
-        Point_2 p1 = v1->point(); // Get the point of the first vertex
-        Point_2 p2 = v2->point(); // Get the point of the second vertex
+    // Set static fields
+    sink.write("{\n  \"content_type\": \"CG_SHOP_2025_Solution\",\n  \"instance_uid\": \"");
+    for (char c : instance_uid)
+    {
+        if (c == '"' || c == '\\')
+            sink.write("\\", 1);
+        sink.write(&c, 1);
+    }
 
-        // Store vertex coordinates in the edge array
-        edge_array.put("vertex1.x", p1.x());
-        edge_array.put("vertex1.y", p1.y());
-        edge_array.put("vertex2.x", p2.x());
-        edge_array.put("vertex2.y", p2.y());
+    // Steiner points get their output index while their x coordinates are written
+    int no_steiner_points = 0;
+    sink.write("\",\n  \"steiner_points_x\": [");
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        if (vit->info() >= 0)
+            continue;
+        if (no_steiner_points > 0)
+            sink.write(", ", 2);
+        vit->info() = num_points + no_steiner_points++;
+        sink.number(CGAL::to_double(vit->point().x()));
+    }
 
-        edges.push_back(std::make_pair("", edge_array));
+    sink.write("],\n  \"steiner_points_y\": [");
+    bool first = true;
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        if (vit->info() < num_points)
+            continue;
+        if (!first)
+            sink.write(", ", 2);
+        first = false;
+        sink.number(CGAL::to_double(vit->point().y()));
     }
-    json_output.add_child("edges", edges);
 
-    // Write JSON output to a file
-    std::ofstream output_file(filename);
-    if (output_file.is_open())
+    // Edges as pairs of vertex indices
+    sink.write("],\n  \"edges\": [");
+    first = true;
+    for (CDT::Finite_edges_iterator edge_it = cdt.finite_edges_begin(); edge_it != cdt.finite_edges_end(); edge_it++)
     {
-        write_json(output_file, json_output);
-        output_file.close();
+        CDT::Vertex_handle v1 = edge_it->first->vertex(cdt.ccw(edge_it->second));
+        CDT::Vertex_handle v2 = edge_it->first->vertex(cdt.cw(edge_it->second));
+
+        sink.write(first ? "[" : ", [", first ? 1 : 3);
+        first = false;
+        sink.number(v1->info());
+        sink.write(", ", 2);
+        sink.number(v2->info());
+        sink.write("]", 1);
     }
-    else
+    sink.write("]\n}\n");
+
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
     {
-        std::cerr << "Error opening file: " << filename << std::endl;
+        if (vit->info() >= num_points)
+            vit->info() = -1; // Steiner point
     }
 }
\ No newline at end of file
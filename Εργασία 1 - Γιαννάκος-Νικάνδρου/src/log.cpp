@@ -0,0 +1,42 @@
+#include "./func.h"
+#include <iostream>
+
+std::atomic<int> log_level(LOG_LEVEL);
+
+log_sink &log_output()
+{
+    static log_sink sink;
+    return sink;
+}
+
+void log_sink::write(int level, const string &line)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (level <= LOG_LEVEL_WARN)
+    {
+        flush_locked(); // Keep the order of the lines
+        cerr << line;
+        cerr.flush();
+        return;
+    }
+
+    buffer += line;
+    if (buffer.size() >= (1 << 16) || std::chrono::steady_clock::now() - last_flush >= std::chrono::milliseconds(200))
+        flush_locked();
+}
+
+void log_sink::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    flush_locked();
+}
+
+void log_sink::flush_locked()
+{
+    last_flush = std::chrono::steady_clock::now();
+    if (buffer.empty())
+        return;
+    cout.write(buffer.data(), buffer.size());
+    cout.flush();
+    buffer.clear();
+}
\ No newline at end of file
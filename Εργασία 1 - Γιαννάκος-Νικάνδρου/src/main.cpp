@@ -1,9 +1,95 @@
 #include <iostream>
 #include "./func.h"
 
-int main()
+// Usage: main [instance.json] [--time-limit seconds] [--profile] [--no-arena] [--huge-pages] [--checkpoint file] [--checkpoint-interval seconds] [--resume file]
+//        main --batch <directory or list file> [--out dir] [--threads n] [--time-limit seconds] [--summary file.csv] [--profile] [--no-arena] [--huge-pages]
+//                     [--checkpoint-interval seconds] [--resume]
+// --profile writes the time per phase and the counters of every run next to its solution (x.profile.json)
+// --no-arena puts the CGAL containers back on malloc, --huge-pages backs the arena with transparent huge pages
+// --checkpoint file writes a snapshot of the refinement every --checkpoint-interval seconds (60), --resume file continues from one.
+// The portfolio refines copies of the mesh, it only writes the final mesh.
+// In batch mode the snapshots are <out>/<instance>.checkpoint and --resume picks up the ones that exist.
+// --time-limit and SIGINT/SIGTERM stop the refinement early, the best mesh it reached is still written (a second signal ends at once).
+// In batch mode every instance runs in a child process (main --batch-instance <file> --result file ...), which is killed when it
+// is still running a grace period (10% of the limit, at least 1 s) after its time limit.
+int main(int argc, char *argv[])
 {
+    install_stop_handlers();
+    if (argc > 1 && (string(argv[1]) == "--batch" || string(argv[1]) == "--batch-instance"))
+    {
+        bool child = string(argv[1]) == "--batch-instance";
+        if (argc < 3)
+        {
+            cerr << "Usage: " << argv[0] << " --batch <directory or list file> [--out dir] [--threads n] [--time-limit seconds] [--summary file.csv] [--profile] [--no-arena] [--huge-pages] [--checkpoint-interval seconds] [--resume]" << endl
+                 << "  --time-limit bounds each instance, an instance still running 10% (at least 1 s) after its limit is killed" << endl;
+            return 1;
+        }
+        string output_dir = "../solutions", summary_file = "", result_file = "";
+        int threads = 0; // One per core
+        double time_limit = 0;
+        bool profile = false;
+        double checkpoint_interval = 0; // No checkpoints
+        bool resume = false;
+        for (int i = 3; i < argc; i++)
+        {
+            string option = argv[i];
+            if (option == "--profile")
+                profile = true;
+            else if (option == "--resume")
+                resume = true;
+            else if (option == "--no-arena")
+                arena_enabled = false;
+            else if (option == "--huge-pages")
+                arena_huge_pages = true;
+            else if (i + 1 >= argc)
+                cerr << "Missing value for " << option << endl;
+            else if (option == "--out")
+                output_dir = argv[++i];
+            else if (option == "--threads")
+                threads = std::stoi(argv[++i]);
+            else if (option == "--time-limit")
+                time_limit = std::stod(argv[++i]);
+            else if (option == "--summary")
+                summary_file = argv[++i];
+            else if (option == "--checkpoint-interval")
+                checkpoint_interval = std::stod(argv[++i]);
+            else if (option == "--result")
+                result_file = argv[++i];
+            else
+                cerr << "Unknown option " << argv[i++] << endl;
+        }
+        if (child)
+            return run_batch_instance(argv[2], output_dir, result_file, time_limit, threads, profile, checkpoint_interval, resume);
+        if (summary_file.empty())
+            summary_file = output_dir + "/summary.csv";
+        return run_batch(argv[2], output_dir, threads, time_limit, summary_file, profile, checkpoint_interval, resume, argv[0]);
+    }
+
     string file_path = "../test_instances/instance_test_22_2.json";
+    run_profile profile;
+    string checkpoint_file, resume_file, checkpoint_interval;
+    double time_limit = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]) == "--profile")
+            current_profile = &profile;
+        else if (string(argv[i]) == "--time-limit" && i + 1 < argc)
+            time_limit = std::stod(argv[++i]);
+        else if (string(argv[i]) == "--checkpoint" && i + 1 < argc)
+            checkpoint_file = argv[++i];
+        else if (string(argv[i]) == "--checkpoint-interval" && i + 1 < argc)
+            checkpoint_interval = argv[++i];
+        else if (string(argv[i]) == "--resume" && i + 1 < argc)
+            resume_file = argv[++i];
+        else if (string(argv[i]) == "--no-arena")
+            arena_enabled = false;
+        else if (string(argv[i]) == "--huge-pages")
+            arena_huge_pages = true;
+        else
+            file_path = argv[i];
+    }
+    auto deadline = deadline_after(time_limit); // Counted from here, reading included, as in batch mode
+    profile_scope read_scope(PHASE_READ);
     string instance_uid;
     int num__constraints = 0;
     vector<Point_2> points;
@@ -13,52 +99,79 @@ int main()
     ptree parameters;
     bool delaunay;
 
-    if (read_json_file(file_path, instance_uid, points, region_boundary, num__constraints, additional_constraints, method, parameters, delaunay))
+    bool read_ok = read_instance_file(file_path, instance_uid, points, region_boundary, num__constraints, additional_constraints, method, parameters, delaunay);
+    read_scope.stop();
+    if (read_ok)
     {
-        cout << "Instance UID: " << instance_uid << endl;
-        cout << "Method: " << method << endl;
-        cout << "Delaunay: " << (delaunay ? "true" : "false") << endl;
+        LOG_INFO("Instance UID: " << instance_uid);
+        LOG_INFO("Method: " << method);
+        LOG_INFO("Delaunay: " << (delaunay ? "true" : "false"));
 
-        cout << "Points:" << endl;
+        // The whole input only at debug level, on big instances it is most of the output.
+        // The loops are compiled out with the lines, an empty loop would leave its variable unused.
+        LOG_INFO("Points: " << points.size());
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
         for (const auto &point : points)
         {
-            cout << "(" << point.x() << ", " << point.y() << ")" << endl;
+            LOG_DEBUG("(" << point.x() << ", " << point.y() << ")");
         }
+#endif
 
-        cout << "Region Boundary:" << endl;
+        LOG_INFO("Region Boundary: " << region_boundary.size() << " points");
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
         for (int index : region_boundary)
         {
-            cout << index << " ";
+            LOG_DEBUG(index);
         }
-        cout << endl;
+#endif
 
-        cout << "Additional Constraints:" << endl;
+        LOG_INFO("Additional Constraints: " << additional_constraints.size());
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
         for (const auto &constraint : additional_constraints)
         {
-            cout << "(" << constraint.first << ", " << constraint.second << ")" << endl;
+            LOG_DEBUG("(" << constraint.first << ", " << constraint.second << ")");
         }
-        cout << "Num_constraints: " << num__constraints << endl;
+#endif
+        LOG_INFO("Num_constraints: " << num__constraints);
 
-        cout << "Parameters for " << method << ":" << endl;
+        LOG_INFO("Parameters for " << method << ":");
         for (const auto &param : parameters)
         {
-            cout << "  " << param.first << ": " << param.second.data() << endl;
+            LOG_INFO("  " << param.first << ": " << param.second.data());
         }
     }
 
-    cout << "Commencing Triangulation" << endl;
+    // The checkpoint options reach the refinement with the method parameters
+    if (!checkpoint_file.empty())
+        parameters.put("checkpoint", checkpoint_file);
+    if (!checkpoint_interval.empty())
+        parameters.put("checkpoint_interval", checkpoint_interval);
+    if (!resume_file.empty())
+        parameters.put("resume", resume_file);
+
+    LOG_INFO("Commencing Triangulation");
     CDT cdt;
 
-    cdt = triangulation(points, region_boundary, additional_constraints, parameters);
+    cdt = triangulation(points, region_boundary, additional_constraints, method, parameters, deadline);
 
-    cout << "Went Well...." << endl;
+    if (stop_requested)
+        LOG_WARN("Interrupted, writing the best mesh found");
+    LOG_INFO("Went Well....");
 
     analyze_obtuse_angles(cdt);
 
     std::string filename = "../output.json"; // Specify your desired output filename
-    create_json_output(cdt, filename);
+    {
+        profile_scope write_scope(PHASE_WRITE_SOLUTION);
+        create_json_output(cdt, instance_uid, points.size(), filename);
+    }
 
-    export_to_svg(cdt, "output.svg");
+    {
+        profile_scope export_scope(PHASE_EXPORT_SVG);
+        export_to_svg(cdt, "output.svg");
+    }
 
+    if (current_profile != nullptr)
+        profile.write_json(profile_file_name(filename), instance_uid);
     return 0;
 }
\ No newline at end of file
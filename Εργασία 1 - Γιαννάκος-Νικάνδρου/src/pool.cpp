@@ -0,0 +1,90 @@
+#include "./func.h"
+#include <iostream>
+
+// threads counts the calling thread too, task_pool(1) runs everything on the caller
+task_pool::task_pool(int threads)
+{
+    for (int t = 1; t < threads; t++)
+        workers.emplace_back(&task_pool::worker_loop, this);
+}
+
+task_pool::~task_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+// Run task(0) .. task(tasks - 1) on the workers and the calling thread, returns when all are done.
+// The first exception thrown by a task is rethrown here.
+void task_pool::run(int tasks, const std::function<void(int)> &task)
+{
+    if (workers.empty() || tasks <= 1)
+    {
+        for (int i = 0; i < tasks; i++)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        job_tasks = tasks;
+        next_task = 0;
+        active = workers.size();
+        error = nullptr;
+        generation++;
+    }
+    wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]() { return active == 0; });
+    job = nullptr;
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Take tasks of the current job until there are none left
+void task_pool::work()
+{
+    for (int i = next_task++; i < job_tasks; i = next_task++)
+    {
+        try
+        {
+            (*job)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+}
+
+void task_pool::worker_loop()
+{
+    long seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stop || generation != seen; });
+            if (stop)
+                return;
+            seen = generation;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0)
+            finished.notify_one();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "./func.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+// Configurations raced when parameters_portfolio has none: the local search with the default weights,
+// with the weight on the obtuse count and with the weight on the largest angle, the local search after
+// a flip pass, and simulated annealing
+static ptree default_configurations()
+{
+    ptree configurations;
+    auto add = [&](const string &method, double obtuse_faces, double max_angle, double total_obtuse_sum, bool flips_first)
+    {
+        ptree configuration;
+        configuration.put("method", method);
+        configuration.put("weight_obtuse_faces", obtuse_faces);
+        configuration.put("weight_max_angle", max_angle);
+        configuration.put("weight_total_obtuse_sum", total_obtuse_sum);
+        configuration.put("flips_first", flips_first);
+        configurations.push_back({"", configuration});
+    };
+    add("local", weight_obtuse_faces, weight_max_angle, weight_total_obtuse_sum, false);
+    add("local", 20.0, 1.0, 0.5, false);
+    add("local", 5.0, 20.0, 1.0, false);
+    add("local", weight_obtuse_faces, weight_max_angle, weight_total_obtuse_sum, true);
+    add("sa", weight_obtuse_faces, weight_max_angle, weight_total_obtuse_sum, false);
+    return configurations;
+}
+
+// One run of the portfolio, on a worker thread and from a copy of the shared mesh
+static void race(portfolio_run &run, const CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region,
+                 std::chrono::steady_clock::time_point deadline)
+{
+    current_control = &run.control;
+    auto start = std::chrono::steady_clock::now();
+    run.start = start;
+    run.started = true;
+
+    run.cdt = cdt; // Only reads the shared mesh, the runs copy it at the same time
+    mesh_score score;
+    score.rebuild(run.cdt);
+    vertex_index index;
+    index.rebuild(run.cdt);
+    refine_mesh(run.cdt, constraints, region, score, index, run.method, run.parameters, run.max_steiner_points, deadline);
+
+    // Every method ends on the best mesh it reached, also when it was cancelled
+    run.no_obtuse_faces = score.no_obtuse_faces;
+    for (CDT::Finite_vertices_iterator vit = run.cdt.finite_vertices_begin(); vit != run.cdt.finite_vertices_end(); vit++)
+    {
+        if (vit->info() < 0)
+            run.steiner_points++;
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    current_control = nullptr;
+    run.done = true;
+}
+
+// Portfolio (parameters_portfolio: configurations, grace, dominance, L, threads). Every configuration is a set
+// of method parameters on top of the portfolio ones, with its method in "method". Each run refines a copy of
+// the mesh, up to threads of them (0 = one per core) at the same time under the same signal handling; the
+// threads left over go to the runs themselves. When the runs have to wait for a worker, each one gets its
+// share of the time left to the deadline. A run is cancelled early when it cannot win any more: another run
+// has no obtuse faces left with fewer Steiner points than this one already has, or grace seconds after its
+// start it has removed less than dominance times the obtuse faces the leading run removed. The best final
+// mesh (fewest obtuse faces, then fewest Steiner points) replaces cdt.
+void portfolio_refinement(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                          ptree parameters, int max_steiner_points, std::chrono::steady_clock::time_point deadline)
+{
+    double grace = parameters.get<double>("grace", 2.0);
+    double dominance = parameters.get<double>("dominance", 0.5);
+    int threads = thread_parameter(parameters, "threads");
+    ptree configurations = parameters.get_child("configurations", ptree());
+    parameters.erase("configurations");
+    if (configurations.empty())
+        configurations = default_configurations();
+
+    vector<portfolio_run> runs(configurations.size());
+    size_t k = 0;
+    for (const auto &configuration : configurations)
+    {
+        portfolio_run &run = runs[k++];
+        run.parameters = parameters;
+        for (const auto &setting : configuration.second)
+            run.parameters.put_child(setting.first, setting.second);
+        run.method = run.parameters.get<string>("method", "local");
+        run.max_steiner_points = configuration.second.get<int>("L", max_steiner_points);
+        if (run.method == "portfolio")
+        {
+            LOG_WARN("A portfolio cannot race another portfolio, configuration " << k << " runs the local search");
+            run.method = "local";
+        }
+    }
+    profile_count(COUNTER_CDT_COPIES, runs.size());
+
+    int no_workers = std::min<int>(threads, runs.size());
+    int run_threads = std::max(1, threads / no_workers);
+    for (auto &run : runs)
+    {
+        int requested = run.parameters.get<int>("threads", 0);
+        if (requested <= 0 || requested > run_threads)
+            run.parameters.put("threads", run_threads);
+    }
+
+    LOG_INFO("Portfolio: " << runs.size() << " configurations from " << score.no_obtuse_faces << " obtuse faces on " << no_workers
+             << " threads, " << run_threads << " per run");
+    int start_obtuse_faces = score.no_obtuse_faces;
+    std::atomic<size_t> next(0);
+    vector<std::thread> workers;
+    for (int w = 0; w < no_workers; w++)
+    {
+        workers.emplace_back([&]()
+                             {
+            for (size_t i = next++; i < runs.size(); i = next++)
+            {
+                // The runs still waiting share the time left with this one, a wave of no_workers at a time
+                auto run_deadline = deadline;
+                auto now = std::chrono::steady_clock::now();
+                if (deadline != std::chrono::steady_clock::time_point::max() && now < deadline)
+                {
+                    size_t waves = (runs.size() - i + no_workers - 1) / no_workers;
+                    run_deadline = now + (deadline - now) / waves;
+                }
+                race(runs[i], cdt, constraints, region, run_deadline);
+            } });
+    }
+
+    // Referee: the runs only publish their best mesh so far, the meshes themselves are not touched until they finish
+    bool running = true;
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        running = false;
+        int leader = -1;
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            running = running || !runs[i].done;
+            int obtuse = runs[i].control.no_obtuse_faces;
+            if (obtuse < 0)
+                continue;
+            if (leader < 0 || obtuse < runs[leader].control.no_obtuse_faces ||
+                (obtuse == runs[leader].control.no_obtuse_faces && runs[i].control.best_steiner_points < runs[leader].control.best_steiner_points))
+                leader = i;
+        }
+        if (leader < 0)
+            continue;
+
+        int leader_obtuse = runs[leader].control.no_obtuse_faces;
+        int leader_steiner = runs[leader].control.best_steiner_points;
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < runs.size(); i++)
+        {
+            portfolio_run &run = runs[i];
+            if ((int)i == leader || !run.started || run.done || run.control.cancel || run.control.no_obtuse_faces < 0)
+                continue;
+            bool judged = std::chrono::duration<double>(now - run.start).count() >= grace;
+
+            // The Steiner points only grow, a run that already has as many as an acute mesh cannot beat it
+            bool beaten = leader_obtuse == 0 && run.control.steiner_points >= leader_steiner;
+            bool behind = judged && start_obtuse_faces - run.control.no_obtuse_faces < dominance * (start_obtuse_faces - leader_obtuse);
+            if (beaten || behind)
+            {
+                LOG_INFO("Portfolio: run " << i << " (" << run.method << ") cancelled at " << run.control.no_obtuse_faces
+                         << " obtuse faces, the leader (run " << leader << ") has " << leader_obtuse);
+                run.control.cancel = true;
+            }
+        }
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    size_t best = 0;
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        LOG_INFO("Portfolio: run " << i << " (" << runs[i].method << (runs[i].control.cancel ? ", cancelled" : "") << "): "
+                 << runs[i].no_obtuse_faces << " obtuse faces, " << runs[i].steiner_points << " Steiner points, " << runs[i].seconds << " s");
+        if (runs[i].no_obtuse_faces < runs[best].no_obtuse_faces ||
+            (runs[i].no_obtuse_faces == runs[best].no_obtuse_faces && runs[i].steiner_points < runs[best].steiner_points))
+            best = i;
+    }
+    LOG_INFO("Portfolio: run " << best << " (" << runs[best].method << ") wins");
+
+    // The handles of the old mesh are gone, the caller's score and index follow the new one
+    cdt.swap(runs[best].cdt);
+    score.rebuild(cdt);
+    index.rebuild(cdt);
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "./func.h"
+#include <iostream>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL 1
+#endif
+
+// Index (0, 1, 2) of the vertex with the obtuse angle, -1 if the triangle is not obtuse.
+// The angle at a vertex is obtuse exactly when the dot product of its two edges is negative,
+// so no sqrt or acos is needed.
+int obtuse_vertex(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
+{
+    double x1 = CGAL::to_double(p1.x()), y1 = CGAL::to_double(p1.y());
+    double x2 = CGAL::to_double(p2.x()), y2 = CGAL::to_double(p2.y());
+    double x3 = CGAL::to_double(p3.x()), y3 = CGAL::to_double(p3.y());
+
+    if ((x2 - x1) * (x3 - x1) + (y2 - y1) * (y3 - y1) < 0)
+        return 0;
+    if ((x1 - x2) * (x3 - x2) + (y1 - y2) * (y3 - y2) < 0)
+        return 1;
+    if ((x1 - x3) * (x2 - x3) + (y1 - y3) * (y2 - y3) < 0)
+        return 2;
+    return -1;
+}
+
+// Cosine of the angle at p1 (one sqrt), enough to order angles without going to degrees
+double angle_cosine(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
+{
+    Kernel::Vector_2 v1 = p2 - p1;
+    Kernel::Vector_2 v2 = p3 - p1;
+    double length_product = std::sqrt(CGAL::to_double(v1.squared_length() * v2.squared_length()));
+    if (length_product == 0)
+        return 1; // Same as a zero angle
+    return CGAL::to_double(v1 * v2) / length_product;
+}
+
+bool is_degenerate_triangle(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
+{
+    return CGAL::orientation(p1, p2, p3) == CGAL::COLLINEAR;
+}
+
+void triangle_batch::push_back(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
+{
+    ax.push_back(CGAL::to_double(p1.x()));
+    ay.push_back(CGAL::to_double(p1.y()));
+    bx.push_back(CGAL::to_double(p2.x()));
+    by.push_back(CGAL::to_double(p2.y()));
+    cx.push_back(CGAL::to_double(p3.x()));
+    cy.push_back(CGAL::to_double(p3.y()));
+}
+
+void triangle_batch::reserve(size_t n)
+{
+    ax.reserve(n);
+    ay.reserve(n);
+    bx.reserve(n);
+    by.reserve(n);
+    cx.reserve(n);
+    cy.reserve(n);
+}
+
+void triangle_batch::clear()
+{
+    ax.clear();
+    ay.clear();
+    bx.clear();
+    by.clear();
+    cx.clear();
+    cy.clear();
+}
+
+static void classify_obtuse_scalar(const triangle_batch &batch, size_t first, vector<int8_t> &obtuse)
+{
+    for (size_t i = first; i < batch.size(); i++)
+    {
+        double abx = batch.bx[i] - batch.ax[i], aby = batch.by[i] - batch.ay[i];
+        double acx = batch.cx[i] - batch.ax[i], acy = batch.cy[i] - batch.ay[i];
+        double bcx = batch.cx[i] - batch.bx[i], bcy = batch.cy[i] - batch.by[i];
+
+        if (abx * acx + aby * acy < 0)
+            obtuse[i] = 0;
+        else if (abx * bcx + aby * bcy > 0) // (a - b) . (c - b) < 0
+            obtuse[i] = 1;
+        else if (acx * bcx + acy * bcy < 0) // (a - c) . (b - c) < 0
+            obtuse[i] = 2;
+        else
+            obtuse[i] = -1;
+    }
+}
+
+#ifdef HAVE_AVX2_KERNEL
+// Four triangles per iteration, the remainder goes through the scalar loop
+__attribute__((target("avx2"))) static size_t classify_obtuse_avx2(const triangle_batch &batch, vector<int8_t> &obtuse)
+{
+    const __m256d zero = _mm256_setzero_pd();
+    size_t n = batch.size() & ~size_t(3);
+    for (size_t i = 0; i < n; i += 4)
+    {
+        __m256d ax = _mm256_loadu_pd(&batch.ax[i]), ay = _mm256_loadu_pd(&batch.ay[i]);
+        __m256d bx = _mm256_loadu_pd(&batch.bx[i]), by = _mm256_loadu_pd(&batch.by[i]);
+        __m256d cx = _mm256_loadu_pd(&batch.cx[i]), cy = _mm256_loadu_pd(&batch.cy[i]);
+
+        __m256d abx = _mm256_sub_pd(bx, ax), aby = _mm256_sub_pd(by, ay);
+        __m256d acx = _mm256_sub_pd(cx, ax), acy = _mm256_sub_pd(cy, ay);
+        __m256d bcx = _mm256_sub_pd(cx, bx), bcy = _mm256_sub_pd(cy, by);
+
+        __m256d dot_a = _mm256_add_pd(_mm256_mul_pd(abx, acx), _mm256_mul_pd(aby, acy));
+        __m256d dot_b = _mm256_add_pd(_mm256_mul_pd(abx, bcx), _mm256_mul_pd(aby, bcy));
+        __m256d dot_c = _mm256_add_pd(_mm256_mul_pd(acx, bcx), _mm256_mul_pd(acy, bcy));
+
+        int mask_a = _mm256_movemask_pd(_mm256_cmp_pd(dot_a, zero, _CMP_LT_OQ));
+        int mask_b = _mm256_movemask_pd(_mm256_cmp_pd(dot_b, zero, _CMP_GT_OQ));
+        int mask_c = _mm256_movemask_pd(_mm256_cmp_pd(dot_c, zero, _CMP_LT_OQ));
+
+        for (int k = 0; k < 4; k++)
+        {
+            if (mask_a & (1 << k))
+                obtuse[i + k] = 0;
+            else if (mask_b & (1 << k))
+                obtuse[i + k] = 1;
+            else if (mask_c & (1 << k))
+                obtuse[i + k] = 2;
+            else
+                obtuse[i + k] = -1;
+        }
+    }
+    return n;
+}
+#endif
+
+// Obtuse vertex (or -1) of every triangle in the batch, AVX2 when the CPU has it
+void classify_obtuse_batch(const triangle_batch &batch, vector<int8_t> &obtuse)
+{
+    obtuse.resize(batch.size());
+    size_t first = 0;
+#ifdef HAVE_AVX2_KERNEL
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2)
+        first = classify_obtuse_avx2(batch, obtuse);
+#endif
+    classify_obtuse_scalar(batch, first, obtuse);
+}
+
+// Scalar only path, kept for the benchmark and for checking the AVX2 kernel
+void classify_obtuse_batch_scalar(const triangle_batch &batch, vector<int8_t> &obtuse)
+{
+    obtuse.resize(batch.size());
+    classify_obtuse_scalar(batch, 0, obtuse);
+}
\ No newline at end of file
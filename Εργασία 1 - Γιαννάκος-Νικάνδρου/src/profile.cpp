@@ -0,0 +1,50 @@
+#include "./func.h"
+#include <fstream>
+
+thread_local run_profile *current_profile = nullptr;
+
+static const char *phase_names[PHASE_COUNT] = {"read", "insert_points", "insert_constraints", "refine", "evaluate_candidates",
+                                               "write_solution", "export_svg", "checkpoint"};
+
+static const char *counter_names[COUNTER_COUNT] = {"faces_scanned", "candidates", "rejected_duplicate", "rejected_outside",
+                                                   "rejected_no_conflict_zone", "cdt_copies", "flips_attempted", "steiner_points", "wasted_steps"};
+
+const char *profile_counter_name(profile_counter counter)
+{
+    return counter_names[counter];
+}
+
+// Report file next to the solution: x.solution.json -> x.profile.json, x.json -> x.profile.json
+string profile_file_name(const string &solution_file)
+{
+    string base = solution_file;
+    for (const string suffix : {".solution.json", ".json"})
+    {
+        if (base.size() > suffix.size() && base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0)
+        {
+            base.erase(base.size() - suffix.size());
+            break;
+        }
+    }
+    return base + ".profile.json";
+}
+
+bool run_profile::write_json(const string &filename, const string &instance_uid) const
+{
+    std::ofstream out(filename);
+    if (!out)
+    {
+        LOG_ERROR("Error opening file: " << filename);
+        return false;
+    }
+
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    out << "{\n  \"instance_uid\": \"" << instance_uid << "\",\n  \"kernel\": \"" << KERNEL_NAME << "\",\n  \"total_seconds\": " << total << ",\n  \"phases\": {";
+    for (int i = 0; i < PHASE_COUNT; i++)
+        out << (i ? ",\n" : "\n") << "    \"" << phase_names[i] << "\": {\"seconds\": " << seconds[i] << ", \"calls\": " << calls[i] << "}";
+    out << "\n  },\n  \"counters\": {";
+    for (int i = 0; i < COUNTER_COUNT; i++)
+        out << (i ? ",\n" : "\n") << "    \"" << counter_names[i] << "\": " << counters[i];
+    out << "\n  }\n}\n";
+    return bool(out);
+}
\ No newline at end of file
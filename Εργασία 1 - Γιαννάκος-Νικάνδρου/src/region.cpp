@@ -0,0 +1,207 @@
+#include "./func.h"
+#include <iostream>
+#include <algorithm>
+
+// Build the region polygon from region_boundary (in the given order), check it once
+// and bucket its edges into a uniform grid of about one cell per edge
+bool region_index::build(const vector<Point_2> &points, const vector<int> &region_boundary)
+{
+    valid = false;
+    clipped = false;
+    polygon = Polygon_2();
+    cell_start.clear();
+    cell_edges.clear();
+    cell_state.clear();
+
+    if (region_boundary.size() < 3)
+    {
+        LOG_WARN("Region boundary has less than 3 points, the region is not checked.");
+        return false;
+    }
+    for (int index : region_boundary)
+    {
+        if (index < 0 || index >= (int)points.size())
+        {
+            LOG_WARN("Region boundary refers to point " << index << " which does not exist.");
+            return false;
+        }
+        polygon.push_back(points[index]);
+    }
+    if (!polygon.is_simple())
+    {
+        LOG_WARN("Region boundary is not a simple polygon, the region is not checked.");
+        return false;
+    }
+
+    int n = polygon.size();
+    min_x = max_x = CGAL::to_double(polygon[0].x());
+    min_y = max_y = CGAL::to_double(polygon[0].y());
+    for (int i = 1; i < n; i++)
+    {
+        min_x = std::min(min_x, CGAL::to_double(polygon[i].x()));
+        max_x = std::max(max_x, CGAL::to_double(polygon[i].x()));
+        min_y = std::min(min_y, CGAL::to_double(polygon[i].y()));
+        max_y = std::max(max_y, CGAL::to_double(polygon[i].y()));
+    }
+
+    // Square cells, about as many as there are edges
+    double side = std::sqrt((max_x - min_x) * (max_y - min_y) / n);
+    columns = std::max(1, std::min(2048, (int)std::ceil((max_x - min_x) / side)));
+    rows = std::max(1, std::min(2048, (int)std::ceil((max_y - min_y) / side)));
+    cell_width = (max_x - min_x) / columns;
+    cell_height = (max_y - min_y) / rows;
+
+    // Every edge goes into the cells its bounding box overlaps (counted first, then filled)
+    vector<int> first_column(n), last_column(n), first_row(n), last_row(n);
+    cell_start.assign(columns * rows + 1, 0);
+    for (int e = 0; e < n; e++)
+    {
+        const Point_2 &a = polygon[e];
+        const Point_2 &b = polygon[(e + 1) % n];
+        first_column[e] = column_of(std::min(CGAL::to_double(a.x()), CGAL::to_double(b.x())));
+        last_column[e] = column_of(std::max(CGAL::to_double(a.x()), CGAL::to_double(b.x())));
+        first_row[e] = row_of(std::min(CGAL::to_double(a.y()), CGAL::to_double(b.y())));
+        last_row[e] = row_of(std::max(CGAL::to_double(a.y()), CGAL::to_double(b.y())));
+        for (int r = first_row[e]; r <= last_row[e]; r++)
+            for (int c = first_column[e]; c <= last_column[e]; c++)
+                cell_start[r * columns + c + 1]++;
+    }
+    for (int cell = 0; cell < columns * rows; cell++)
+        cell_start[cell + 1] += cell_start[cell];
+
+    cell_edges.resize(cell_start.back());
+    vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+    vector<vector<int>> row_edges(rows);
+    for (int e = 0; e < n; e++)
+    {
+        for (int r = first_row[e]; r <= last_row[e]; r++)
+        {
+            row_edges[r].push_back(e);
+            for (int c = first_column[e]; c <= last_column[e]; c++)
+                cell_edges[fill[r * columns + c]++] = e;
+        }
+    }
+
+    // Inside / outside of every cell center, one horizontal scanline per row
+    cell_state.assign(columns * rows, 0);
+    vector<double> crossings;
+    for (int r = 0; r < rows; r++)
+    {
+        double y = min_y + (r + 0.5) * cell_height;
+        crossings.clear();
+        for (int e : row_edges[r])
+        {
+            double ax = CGAL::to_double(polygon[e].x()), ay = CGAL::to_double(polygon[e].y());
+            double bx = CGAL::to_double(polygon[(e + 1) % n].x()), by = CGAL::to_double(polygon[(e + 1) % n].y());
+            if (ay == y && by == y)
+            {
+                // Horizontal edge on the scanline, the centers on it are on the boundary
+                for (int c = column_of(std::min(ax, bx)); c <= column_of(std::max(ax, bx)); c++)
+                {
+                    double x = min_x + (c + 0.5) * cell_width;
+                    if (x >= std::min(ax, bx) && x <= std::max(ax, bx))
+                        cell_state[r * columns + c] = -1;
+                }
+            }
+            else if ((ay > y) != (by > y))
+                crossings.push_back(ax + (y - ay) * (bx - ax) / (by - ay));
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        for (int c = 0; c < columns; c++)
+        {
+            int cell = r * columns + c;
+            if (cell_state[cell] < 0)
+                continue;
+            double x = min_x + (c + 0.5) * cell_width;
+            double tolerance = 1e-9 * cell_width;
+            auto it = std::lower_bound(crossings.begin(), crossings.end(), x - tolerance);
+            if (it != crossings.end() && *it <= x + tolerance)
+                cell_state[cell] = -1; // Too close to an edge to trust the parity
+            else
+                cell_state[cell] = (it - crossings.begin()) % 2;
+        }
+    }
+
+    valid = true;
+    return true;
+}
+
+int region_index::column_of(double x) const
+{
+    return std::max(0, std::min(columns - 1, (int)((x - min_x) / cell_width)));
+}
+
+int region_index::row_of(double y) const
+{
+    return std::max(0, std::min(rows - 1, (int)((y - min_y) / cell_height)));
+}
+
+// Restrict the region to the open box (min_x, max_x) x (min_y, max_y). Used by the tiled
+// refinement: a tile only accepts candidates strictly inside its own rectangle, so two
+// tiles never place a point on the same seam.
+void region_index::clip(double min_x, double min_y, double max_x, double max_y)
+{
+    clipped = true;
+    clip_min_x = min_x;
+    clip_min_y = min_y;
+    clip_max_x = max_x;
+    clip_max_y = max_y;
+}
+
+// Points on the boundary count as inside. Without a valid region every point is accepted.
+bool region_index::contains(const Point_2 &point) const
+{
+    double x = CGAL::to_double(point.x()), y = CGAL::to_double(point.y());
+    if (clipped && (x <= clip_min_x || x >= clip_max_x || y <= clip_min_y || y >= clip_max_y))
+        return false;
+    if (!valid)
+        return true;
+
+    if (x < min_x || x > max_x || y < min_y || y > max_y)
+        return false;
+
+    int c = column_of(x), r = row_of(y);
+    int cell = r * columns + c;
+    if (cell_state[cell] < 0)
+        return polygon.bounded_side(point) != CGAL::ON_UNBOUNDED_SIDE;
+
+    // Start from the cell center and flip for every edge the segment center-point crosses.
+    // The segment stays inside the cell, so only the edges of the cell can cross it.
+    Point_2 center(min_x + (c + 0.5) * cell_width, min_y + (r + 0.5) * cell_height);
+    bool inside = cell_state[cell] == 1;
+    int n = polygon.size();
+    for (int k = cell_start[cell]; k < cell_start[cell + 1]; k++)
+    {
+        const Point_2 &a = polygon[cell_edges[k]];
+        const Point_2 &b = polygon[(cell_edges[k] + 1) % n];
+
+        CGAL::Orientation side_of_point = CGAL::orientation(a, b, point);
+        if (side_of_point == CGAL::COLLINEAR)
+        {
+            if (std::min(a.x(), b.x()) <= point.x() && point.x() <= std::max(a.x(), b.x()) &&
+                std::min(a.y(), b.y()) <= point.y() && point.y() <= std::max(a.y(), b.y()))
+                return true; // On the boundary
+            continue;
+        }
+        CGAL::Orientation side_of_center = CGAL::orientation(a, b, center);
+        if (side_of_center == CGAL::COLLINEAR || side_of_center == side_of_point)
+            continue;
+
+        CGAL::Orientation side_of_a = CGAL::orientation(center, point, a);
+        CGAL::Orientation side_of_b = CGAL::orientation(center, point, b);
+        if (side_of_a == CGAL::COLLINEAR || side_of_b == CGAL::COLLINEAR)
+            return polygon.bounded_side(point) != CGAL::ON_UNBOUNDED_SIDE; // Passes through a polygon vertex
+        if (side_of_a != side_of_b)
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Batch query, inside[i] is 1 if points[i] is in the region
+void region_index::contains(const vector<Point_2> &points, vector<int8_t> &inside) const
+{
+    inside.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        inside[i] = contains(points[i]);
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "./func.h"
+#include <iostream>
+#include <random>
+
+// Queue the face if it is obtuse (and not degenerate)
+void obtuse_sampler::push_face(const CDT &cdt, CDT::Face_handle face)
+{
+    if (cdt.is_infinite(face))
+        return;
+    const Point_2 &p1 = face->vertex(0)->point(), &p2 = face->vertex(1)->point(), &p3 = face->vertex(2)->point();
+    if (obtuse_vertex(p1, p2, p3) >= 0 && !is_degenerate_triangle(p1, p2, p3))
+        faces.push_back({face->vertex(0), face->vertex(1), face->vertex(2)});
+}
+
+void obtuse_sampler::push_all_faces(const CDT &cdt)
+{
+    for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); face_it++)
+        push_face(cdt, face_it);
+}
+
+void obtuse_sampler::push_incident_faces(const CDT &cdt, CDT::Vertex_handle vertex)
+{
+    CDT::Face_circulator fc = cdt.incident_faces(vertex), done = fc;
+    if (fc == nullptr)
+        return;
+    do
+    {
+        push_face(cdt, fc);
+    } while (++fc != done);
+}
+
+// Uniformly random obtuse face. Entries whose face no longer exists (or is no longer obtuse)
+// are removed when they are drawn, by swapping them with the last entry.
+bool obtuse_sampler::sample(const CDT &cdt, std::mt19937 &gen, CDT::Face_handle &face, int &obtuse_index)
+{
+    while (!faces.empty())
+    {
+        size_t k = std::uniform_int_distribution<size_t>(0, faces.size() - 1)(gen);
+        const auto &entry = faces[k];
+        if (cdt.is_face(entry[0], entry[1], entry[2], face))
+        {
+            obtuse_index = obtuse_vertex(face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point());
+            if (obtuse_index >= 0)
+                return true;
+        }
+        faces[k] = faces.back();
+        faces.pop_back();
+    }
+    return false;
+}
+
+// Simulated annealing over Steiner insertions, energy = alpha * obtuse faces + beta * Steiner points.
+// Every temperature step makes one move per obtuse face: a random Steiner point method is applied to a
+// random obtuse face. Both energy terms are kept up to date by the transaction (mesh_score) and a
+// rejected move is rolled back in place instead of restoring a copy of the CDT.
+void simulated_annealing(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                         ptree parameters, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint)
+{
+    double alpha = parameters.get<double>("alpha", 2.0);
+    double beta = parameters.get<double>("beta", 0.2);
+    int L = parameters.get<int>("L", 1000);
+    std::mt19937 gen(parameters.get<unsigned>("seed", 1));
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<int> pick_method(0, 4);
+
+    obtuse_sampler obtuse_faces;
+    obtuse_faces.push_all_faces(cdt);
+    cdt_transaction move(cdt, &score, &index);
+
+    int steiner_count = 0;
+    double energy = alpha * score.no_obtuse_faces;
+    best_solution best; // The energy goes up as well, the run ends on the best mesh it saw
+    best.start(score);
+    long moves = 0, accepted = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    double T = 1.0; // αρχικη θερμοκρασια
+    for (int step = 0; step < L && score.no_obtuse_faces > 0; step++)
+    {
+        if (should_stop(deadline))
+        {
+            LOG_INFO((cancelled() ? "Stop requested" : "Time limit reached") << " at temperature " << T);
+            break;
+        }
+
+        int sweep = score.no_obtuse_faces;
+        for (int m = 0; m < sweep; m++)
+        {
+            // A sweep can be long on a large mesh, the clock is read every 64 moves
+            if (m % 64 == 0 && should_stop(deadline))
+                break;
+            CDT::Face_handle face;
+            int obtuse_index;
+            if (!obtuse_faces.sample(cdt, gen, face, obtuse_index))
+                break;
+            moves++;
+
+            Point_2 point = get_steiner_point(cdt, CDT::Edge(face, obtuse_index), constraints, pick_method(gen));
+            profile_count(COUNTER_CANDIDATES);
+            if (index.contains(point))
+            {
+                profile_count(COUNTER_REJECTED_DUPLICATE);
+                profile_count(COUNTER_WASTED_STEPS);
+                continue;
+            }
+            if (!region.contains(point))
+            {
+                profile_count(COUNTER_REJECTED_OUTSIDE);
+                profile_count(COUNTER_WASTED_STEPS);
+                continue;
+            }
+
+            move.begin();
+            CDT::Vertex_handle vertex = move.insert(point);
+            if (vertex == CDT::Vertex_handle())
+            {
+                profile_count(COUNTER_REJECTED_NO_CONFLICT_ZONE);
+                profile_count(COUNTER_WASTED_STEPS);
+                move.commit();
+                continue;
+            }
+
+            // Only the faces around the new vertex changed, the energy is already up to date
+            double new_energy = alpha * score.no_obtuse_faces + beta * (steiner_count + 1);
+            double delta_energy = new_energy - energy;
+            if (delta_energy < 0 || std::exp(-delta_energy / T) > uniform(gen))
+            {
+                move.commit();
+                steiner_count++;
+                energy = new_energy;
+                accepted++;
+                best.add(vertex, score);
+                obtuse_faces.push_incident_faces(cdt, vertex);
+            }
+            else
+            {
+                move.rollback();
+                energy = alpha * score.no_obtuse_faces + beta * steiner_count; // Same unless the restore was not exact
+            }
+        }
+
+        T -= 1.0 / L; // μειωση θερμοκρασιας
+
+        // The current mesh, not the best one: a resumed run goes on from where this one was
+        if (checkpoint != nullptr && checkpoint->due())
+            checkpoint->write(cdt);
+    }
+
+    steiner_count -= best.restore(cdt, score, index, constraints);
+    energy = alpha * score.no_obtuse_faces + beta * steiner_count;
+
+    profile_count(COUNTER_STEINER_POINTS, steiner_count);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Simulated annealing: " << moves << " moves, " << accepted << " accepted, "
+             << steiner_count << " Steiner points, " << score.no_obtuse_faces << " obtuse faces left, energy " << energy
+             << ", " << (seconds > 0 ? moves / seconds : 0) << " moves/s");
+}
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "./func.h"
+#include <iostream>
+#include <algorithm>
+
+// Penalty terms of a single triangle, only obtuse triangles contribute.
+// A triangle has at most one obtuse angle and that is also its largest,
+// so the angle in degrees is computed once and only for obtuse triangles.
+static face_score score_obtuse_face(int obtuse, const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
+{
+    face_score fs;
+    if (obtuse < 0)
+        return fs;
+
+    const Point_2 *p[3] = {&p1, &p2, &p3};
+    double angle = angle_between_points(*p[obtuse], *p[(obtuse + 1) % 3], *p[(obtuse + 2) % 3]);
+
+    fs.obtuse = true;
+    fs.max_angle = angle;
+    fs.obtuse_angle_sum = angle;
+    return fs;
+}
+
+face_score score_face(const Point_2 &p1, const Point_2 &p2, const Point_2 &p3)
+{
+    return score_obtuse_face(obtuse_vertex(p1, p2, p3), p1, p2, p3);
+}
+
+face_score score_face(const CDT::Face_handle &face)
+{
+    return score_face(face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point());
+}
+
+void mesh_score::add_face(const face_score &fs)
+{
+    if (!fs.obtuse)
+        return;
+    no_obtuse_faces++;
+    total_obtuse_angle_sum += fs.obtuse_angle_sum;
+    obtuse_max_angles.insert(fs.max_angle);
+}
+
+void mesh_score::remove_face(const face_score &fs)
+{
+    if (!fs.obtuse)
+        return;
+    no_obtuse_faces--;
+    total_obtuse_angle_sum -= fs.obtuse_angle_sum;
+    auto it = obtuse_max_angles.find(fs.max_angle);
+    if (it != obtuse_max_angles.end())
+        obtuse_max_angles.erase(it);
+}
+
+// Full scan, used once when the refinement starts
+void mesh_score::rebuild(const CDT &cdt)
+{
+    no_obtuse_faces = 0;
+    total_obtuse_angle_sum = 0;
+    obtuse_max_angles.clear();
+
+    triangle_batch batch;
+    batch.reserve(cdt.number_of_faces());
+    for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); ++face_it)
+        batch.push_back(face_it->vertex(0)->point(), face_it->vertex(1)->point(), face_it->vertex(2)->point());
+
+    vector<face_score> scores;
+    score_faces(batch, scores);
+    for (const auto &fs : scores)
+        add_face(fs);
+}
+
+// Scores of a whole batch, the obtuse test runs on the batched kernel
+void score_faces(const triangle_batch &batch, vector<face_score> &scores)
+{
+    vector<int8_t> obtuse;
+    classify_obtuse_batch(batch, obtuse);
+    scores.assign(batch.size(), face_score());
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        if (obtuse[i] < 0)
+            continue;
+        Point_2 p1(batch.ax[i], batch.ay[i]), p2(batch.bx[i], batch.by[i]), p3(batch.cx[i], batch.cy[i]);
+        scores[i] = score_obtuse_face(obtuse[i], p1, p2, p3);
+    }
+}
+
+double mesh_score::max_angle() const
+{
+    return obtuse_max_angles.empty() ? 0 : *obtuse_max_angles.rbegin();
+}
+
+// Largest obtuse angle once the removed faces are gone and the added faces are in.
+// Only the top of the multiset is walked, as far as the removed faces reach.
+double mesh_score::max_angle_after(const vector<face_score> &removed, const vector<face_score> &added) const
+{
+    vector<double> removed_angles;
+    for (const auto &fs : removed)
+    {
+        if (fs.obtuse)
+            removed_angles.push_back(fs.max_angle);
+    }
+    std::sort(removed_angles.rbegin(), removed_angles.rend());
+
+    double result = 0;
+    size_t j = 0;
+    for (auto it = obtuse_max_angles.rbegin(); it != obtuse_max_angles.rend(); ++it)
+    {
+        while (j < removed_angles.size() && removed_angles[j] > *it)
+            j++;
+        if (j < removed_angles.size() && removed_angles[j] == *it)
+        {
+            j++; // This face is destroyed by the insertion
+            continue;
+        }
+        result = *it;
+        break;
+    }
+
+    for (const auto &fs : added)
+    {
+        if (fs.obtuse)
+            result = std::max(result, fs.max_angle);
+    }
+    return result;
+}
+
+double mesh_score::penalty() const
+{
+    return weights.penalty(no_obtuse_faces, max_angle(), total_obtuse_angle_sum);
+}
+
+void penalty_weights::read(const ptree &parameters)
+{
+    obtuse_faces = parameters.get<double>("weight_obtuse_faces", weight_obtuse_faces);
+    max_angle = parameters.get<double>("weight_max_angle", weight_max_angle);
+    total_obtuse_sum = parameters.get<double>("weight_total_obtuse_sum", weight_total_obtuse_sum);
+}
+
+double penalty_weights::penalty(int no_obtuse_faces, double largest_angle, double total_obtuse_angle_sum) const
+{
+    return (obtuse_faces * no_obtuse_faces) +
+           (max_angle * largest_angle) +
+           (total_obtuse_sum * total_obtuse_angle_sum);
+}
+
+// Faces that the insertion of point would destroy (the conflict zone) and the boundary of
+// that zone. Same walk as the CDT insertion: it spreads over faces whose circumcircle contains
+// the point and never crosses a constrained edge.
+bool get_conflict_zone(const CDT &cdt, const Point_2 &point, vector<CDT::Face_handle> &zone, vector<CDT::Edge> &boundary)
+{
+    zone.clear();
+    boundary.clear();
+    if (cdt.dimension() < 2)
+        return false;
+
+    CDT::Locate_type lt;
+    int li;
+    CDT::Face_handle start = cdt.locate(point, lt, li);
+    return get_conflict_zone(cdt, point, start, lt, li, zone, boundary);
+}
+
+// Same, for a point that is already located (start, lt, li are the result of cdt.locate).
+// Only reads the CDT, so it can run on several threads at once.
+bool get_conflict_zone(const CDT &cdt, const Point_2 &point, CDT::Face_handle start, CDT::Locate_type lt, int li,
+                       vector<CDT::Face_handle> &zone, vector<CDT::Edge> &boundary)
+{
+    zone.clear();
+    boundary.clear();
+    if (cdt.dimension() < 2 || lt == CDT::VERTEX || lt == CDT::OUTSIDE_AFFINE_HULL)
+        return false;
+
+    zone.push_back(start);
+    // A point on a constrained edge splits it, so both sides of the edge are destroyed
+    CDT::Vertex_handle split_a, split_b;
+    if (lt == CDT::EDGE && cdt.is_constrained(CDT::Edge(start, li)))
+    {
+        zone.push_back(start->neighbor(li));
+        split_a = start->vertex(cdt.ccw(li));
+        split_b = start->vertex(cdt.cw(li));
+    }
+
+    for (size_t k = 0; k < zone.size(); k++)
+    {
+        CDT::Face_handle face = zone[k];
+        for (int i = 0; i < 3; i++)
+        {
+            CDT::Face_handle neighbour = face->neighbor(i);
+            if (std::find(zone.begin(), zone.end(), neighbour) != zone.end())
+                continue;
+
+            CDT::Vertex_handle a = face->vertex(cdt.ccw(i));
+            CDT::Vertex_handle b = face->vertex(cdt.cw(i));
+            if ((a == split_a && b == split_b) || (a == split_b && b == split_a))
+                continue; // The split edge itself is not part of the new fan
+
+            if (!cdt.is_constrained(CDT::Edge(face, i)) &&
+                cdt.side_of_oriented_circle(neighbour, point, true) == CGAL::ON_POSITIVE_SIDE)
+                zone.push_back(neighbour);
+            else
+                boundary.push_back(CDT::Edge(face, i));
+        }
+    }
+    return true;
+}
+
+// Penalty of the CDT if point were inserted, computed only over the conflict zone
+// and the fan that replaces it. The CDT is not modified.
+bool evaluate_candidate(const CDT &cdt, const mesh_score &score, const Point_2 &point, contender &ct)
+{
+    if (cdt.dimension() < 2)
+        return false;
+    CDT::Locate_type lt;
+    int li;
+    CDT::Face_handle start = cdt.locate(point, lt, li);
+    return evaluate_candidate(cdt, score, point, start, lt, li, ct);
+}
+
+// Same, for a point that is already located. Point location is the only part of the
+// evaluation that is not safe to run concurrently (the walk uses the CDT's random generator).
+bool evaluate_candidate(const CDT &cdt, const mesh_score &score, const Point_2 &point, CDT::Face_handle start, CDT::Locate_type lt, int li, contender &ct)
+{
+    vector<CDT::Face_handle> zone;
+    vector<CDT::Edge> boundary;
+    if (!get_conflict_zone(cdt, point, start, lt, li, zone, boundary))
+        return false;
+
+    // Destroyed faces first, then the new fan, classified in one batch
+    triangle_batch batch;
+    for (const auto &face : zone)
+    {
+        if (!cdt.is_infinite(face))
+            batch.push_back(face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point());
+    }
+    size_t no_removed = batch.size();
+    for (const auto &edge : boundary)
+    {
+        CDT::Vertex_handle a = edge.first->vertex(cdt.ccw(edge.second));
+        CDT::Vertex_handle b = edge.first->vertex(cdt.cw(edge.second));
+        if (cdt.is_infinite(a) || cdt.is_infinite(b))
+            continue;
+        batch.push_back(point, a->point(), b->point());
+    }
+
+    vector<face_score> scores;
+    score_faces(batch, scores);
+    vector<face_score> removed(scores.begin(), scores.begin() + no_removed);
+    vector<face_score> added(scores.begin() + no_removed, scores.end());
+
+    ct.st_point = point;
+    ct.conflict_faces = zone.size();
+    ct.no_obtuse_faces = score.no_obtuse_faces;
+    ct.total_obtuse_angle_sum = score.total_obtuse_angle_sum;
+    for (const auto &fs : removed)
+    {
+        if (fs.obtuse)
+        {
+            ct.no_obtuse_faces--;
+            ct.total_obtuse_angle_sum -= fs.obtuse_angle_sum;
+        }
+    }
+    for (const auto &fs : added)
+    {
+        if (fs.obtuse)
+        {
+            ct.no_obtuse_faces++;
+            ct.total_obtuse_angle_sum += fs.obtuse_angle_sum;
+        }
+    }
+    ct.max_angle = score.max_angle_after(removed, added);
+
+    ct.cdt_penalty_score = score.weights.penalty(ct.no_obtuse_faces, ct.max_angle, ct.total_obtuse_angle_sum);
+    return true;
+}
+
+// Insert point and keep score in sync: the destroyed faces are taken out before the
+// insertion and the faces around the new vertex are added after it
+CDT::Vertex_handle insert_and_score(CDT &cdt, mesh_score &score, const Point_2 &point)
+{
+    if (cdt.dimension() < 2)
+    {
+        // No faces to track yet, the first triangles are scored from scratch
+        size_t no_vertices = cdt.number_of_vertices();
+        CDT::Vertex_handle vertex = cdt.insert(point);
+        if (cdt.number_of_vertices() > no_vertices)
+            vertex->info() = -1; // Steiner point
+        score.rebuild(cdt);
+        return vertex;
+    }
+
+    vector<CDT::Face_handle> zone;
+    vector<CDT::Edge> boundary;
+    if (!get_conflict_zone(cdt, point, zone, boundary))
+        return cdt.insert(point); // Point is already a vertex, nothing changes
+
+    for (const auto &face : zone)
+    {
+        if (!cdt.is_infinite(face))
+            score.remove_face(score_face(face));
+    }
+
+    CDT::Vertex_handle vertex = cdt.insert(point);
+    vertex->info() = -1; // Steiner point
+
+    CDT::Face_circulator fc = cdt.incident_faces(vertex), done = fc;
+    do
+    {
+        if (!cdt.is_infinite(fc))
+            score.add_face(score_face(fc));
+    } while (++fc != done);
+    return vertex;
+}
\ No newline at end of file
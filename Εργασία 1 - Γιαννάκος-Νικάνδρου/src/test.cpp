@@ -0,0 +1,196 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include "./func.h"
+
+// Regression tests of the mesh edits that are easy to get wrong (make test).
+// Every test prints its name and PASS or FAIL, the exit code is the number of failures.
+
+static int failures = 0;
+
+static void check(bool ok, const string &name)
+{
+    cout << (ok ? "PASS " : "FAIL ") << name << endl;
+    if (!ok)
+        failures++;
+}
+
+static bool is_constrained_edge(const CDT &cdt, CDT::Vertex_handle a, CDT::Vertex_handle b)
+{
+    CDT::Face_handle face;
+    int i;
+    return cdt.is_edge(a, b, face, i) && cdt.is_constrained(CDT::Edge(face, i));
+}
+
+// Two Steiner points split the constraint A-B, removing both (in the given order) has to leave A-B
+// constrained and the constraint in the hierarchy from A to B
+static void test_remove_split_constraint(bool newest_first)
+{
+    CDT cdt;
+    Point_2 a(0, 0), b(4, 0);
+    CDT::Vertex_handle va = cdt.insert(a), vb = cdt.insert(b);
+    va->info() = 0;
+    vb->info() = 1;
+    cdt.insert(Point_2(2, 3))->info() = 2;
+    cdt.insert(Point_2(2, -3))->info() = 3;
+    cdt.insert_constraint(va, vb);
+
+    CDT::Vertex_handle s1 = cdt.insert(Point_2(1, 0));
+    s1->info() = -1;
+    CDT::Vertex_handle s2 = cdt.insert(Point_2(3, 0));
+    s2->info() = -1;
+    bool split = is_constrained_edge(cdt, va, s1) && is_constrained_edge(cdt, s1, s2) && is_constrained_edge(cdt, s2, vb);
+
+    remove_steiner_point(cdt, newest_first ? s2 : s1);
+    remove_steiner_point(cdt, newest_first ? s1 : s2);
+
+    string order = newest_first ? "newest first" : "oldest first";
+    check(split, "Steiner points split the constraint (" + order + ")");
+    check(cdt.number_of_vertices() == 4, "Steiner points removed (" + order + ")");
+    check(is_constrained_edge(cdt, va, vb), "Input edge still constrained (" + order + ")");
+    check(check_constraints(cdt, {{a, b}}), "Constraint still in the hierarchy (" + order + ")");
+}
+
+// input.json with the method fields it leaves out, so that a reader gets through the whole file
+static const string instance_file = "test_instance.json";
+
+static bool write_test_instance()
+{
+    std::ifstream in("../input.json");
+    std::stringstream text;
+    text << in.rdbuf();
+    string json = text.str();
+    size_t last = json.find_last_of('}');
+    if (!in || last == string::npos)
+        return false;
+    json = json.substr(0, last) + ",\n  \"method\": \"local\",\n  \"parameters_local\": {\"L\": 10},\n  \"delaunay\": true\n}\n";
+    std::ofstream out(instance_file);
+    out << json;
+    return (bool)out;
+}
+
+// Every field the two readers fill
+class test_instance
+{
+public:
+    string instance_uid, method;
+    vector<Point_2> points;
+    vector<int> region_boundary;
+    int num_constraints = -1;
+    vector<pair<int, int>> additional_constraints;
+    ptree parameters;
+    bool delaunay = false;
+
+    bool operator==(const test_instance &other) const
+    {
+        return instance_uid == other.instance_uid && method == other.method && points == other.points && region_boundary == other.region_boundary &&
+               num_constraints == other.num_constraints && additional_constraints == other.additional_constraints &&
+               parameters == other.parameters && delaunay == other.delaunay;
+    }
+};
+
+static bool read_test_instance(const string &file_path, test_instance &instance, bool with_ptree = false)
+{
+    auto reader = with_ptree ? read_json_file_ptree : read_json_file;
+    return reader(file_path, instance.instance_uid, instance.points, instance.region_boundary, instance.num_constraints,
+                  instance.additional_constraints, instance.method, instance.parameters, instance.delaunay);
+}
+
+// The hand written reader and the ptree one accept and reject the same files and read the same fields
+static void test_json_readers()
+{
+    test_instance fast, reference;
+    bool fast_ok = read_test_instance("../input.json", fast), reference_ok = read_test_instance("../input.json", reference, true);
+    check(fast_ok == reference_ok, "JSON readers agree on input.json");
+
+    fast = test_instance();
+    reference = test_instance();
+    fast_ok = read_test_instance(instance_file, fast);
+    reference_ok = read_test_instance(instance_file, reference, true);
+    check(fast_ok && reference_ok, "JSON readers read input.json with a method");
+    check(fast == reference, "JSON readers read the same fields");
+}
+
+// Writing an instance in the binary format and reading it back gives the same instance
+static void test_binary_instance()
+{
+    test_instance instance, copy;
+    string binary_file = "test_instance.bin";
+    bool ok = read_test_instance(instance_file, instance) &&
+              write_binary_instance(binary_file, instance.instance_uid, instance.points, instance.region_boundary, instance.num_constraints,
+                                    instance.additional_constraints, instance.method, instance.parameters, instance.delaunay);
+    check(ok && is_binary_instance_file(binary_file), "Binary instance written");
+    check(read_binary_instance(binary_file, copy.instance_uid, copy.points, copy.region_boundary, copy.num_constraints,
+                               copy.additional_constraints, copy.method, copy.parameters, copy.delaunay),
+          "Binary instance read");
+    check(instance == copy, "Binary instance round trip");
+    std::remove(binary_file.c_str());
+}
+
+// Points with their infos and the constraint hierarchy (end points of every constraint), sorted
+static void mesh_contents(const CDT &cdt, vector<pair<Point_2, int>> &vertices, vector<pair<Point_2, Point_2>> &constraints)
+{
+    vertices.clear();
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+        vertices.push_back({vit->point(), vit->info()});
+    std::sort(vertices.begin(), vertices.end());
+    constraint_end_points(cdt, constraints);
+    for (auto &constraint : constraints)
+        constraint = std::minmax(constraint.first, constraint.second);
+    std::sort(constraints.begin(), constraints.end());
+}
+
+// A refined mesh written to a checkpoint and resumed like triangulation does (read_checkpoint, then
+// reinsert_input_constraints) has the same vertices, infos and constraints
+static void test_checkpoint_round_trip()
+{
+    test_instance instance;
+    check(read_test_instance(instance_file, instance), "Checkpoint test instance read");
+
+    CDT cdt;
+    vector<int> indices(instance.points.size());
+    for (size_t i = 0; i < indices.size(); i++)
+        indices[i] = i;
+    vector<CDT::Vertex_handle> vertices;
+    vector<pair<Point_2, Point_2>> constraints;
+    insert_points_sorted(cdt, instance.points, indices, vertices);
+    insert_constraints(cdt, instance.points, vertices, instance.region_boundary, instance.additional_constraints, constraints);
+
+    // A Steiner point on a constraint (it splits it) and one inside
+    if (!constraints.empty())
+        cdt.insert(CGAL::midpoint(constraints[0].first, constraints[0].second))->info() = -1;
+    cdt.insert(CGAL::centroid(instance.points[0], instance.points[1], instance.points[2]))->info() = -1;
+
+    string checkpoint_file = "test_checkpoint.bin";
+    check(write_checkpoint(checkpoint_file, cdt), "Checkpoint written");
+    CDT resumed;
+    vector<pair<Point_2, Point_2>> resumed_constraints;
+    check(read_checkpoint(checkpoint_file, resumed), "Checkpoint read");
+    reinsert_input_constraints(resumed, instance.points, instance.region_boundary, instance.additional_constraints, resumed_constraints);
+    std::remove(checkpoint_file.c_str());
+
+    vector<pair<Point_2, int>> before_vertices, after_vertices;
+    vector<pair<Point_2, Point_2>> before_constraints, after_constraints;
+    mesh_contents(cdt, before_vertices, before_constraints);
+    mesh_contents(resumed, after_vertices, after_constraints);
+    check(before_vertices == after_vertices, "Checkpoint keeps the vertices and infos");
+    check(before_constraints == after_constraints, "Checkpoint keeps the constraint hierarchy");
+    check(resumed_constraints == constraints && check_constraints(resumed, constraints), "Checkpoint gives back the input constraints");
+}
+
+int main()
+{
+    test_remove_split_constraint(true);
+    test_remove_split_constraint(false);
+
+    check(write_test_instance(), "Test instance written");
+    test_json_readers();
+    test_binary_instance();
+    test_checkpoint_round_trip();
+    std::remove(instance_file.c_str());
+
+    cout << (failures == 0 ? "All tests passed" : std::to_string(failures) + " tests failed") << endl;
+    return failures;
+}
\ No newline at end of file
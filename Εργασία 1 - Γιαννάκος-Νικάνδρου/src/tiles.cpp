@@ -0,0 +1,220 @@
+#include "./func.h"
+#include <iostream>
+#include <thread>
+
+// One rectangle of the tile grid and everything its worker needs
+class refinement_tile
+{
+public:
+    double min_x = 0, min_y = 0, max_x = 0, max_y = 0;  // The tile itself, the seams are its sides
+    vector<pair<Point_2, int>> vertices;                // Vertices of the tile and its halo, with their info
+    vector<pair<Point_2, Point_2>> constraints;         // Constraints clipped to the halo
+    vector<Point_2> steiner_points;                     // Result of the tile
+};
+
+// Refine one tile on a CDT of its own. The region is clipped to the tile, so no candidate
+// is placed on or across a seam; the halo only gives the faces next to a seam their real shape.
+static void refine_tile(refinement_tile &tile, const region_index &region, int max_steiner_points,
+                        std::chrono::steady_clock::time_point deadline)
+{
+    CDT cdt;
+    for (const auto &vertex : tile.vertices)
+        cdt.insert(vertex.first)->info() = vertex.second;
+    for (const auto &constraint : tile.constraints)
+        cdt.insert_constraint(constraint.first, constraint.second);
+
+    region_index tile_region = region;
+    tile_region.clip(tile.min_x, tile.min_y, tile.max_x, tile.max_y);
+
+    mesh_score score;
+    score.rebuild(cdt);
+    vertex_index index;
+    index.rebuild(cdt);
+    task_pool pool(1);
+    refine_local(cdt, tile.constraints, tile_region, score, index, pool, max_steiner_points, deadline);
+
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        if (vit->info() == -1)
+            tile.steiner_points.push_back(vit->point());
+    }
+}
+
+static bool in_box(const Point_2 &point, double min_x, double min_y, double max_x, double max_y)
+{
+    double x = CGAL::to_double(point.x()), y = CGAL::to_double(point.y());
+    return x >= min_x && x <= max_x && y >= min_y && y <= max_y;
+}
+
+// Part a-b of the segment p-q that lies in the box (Liang-Barsky), false if the segment misses it.
+// An end point inside the box is kept as it is.
+static bool clip_segment(const Point_2 &p, const Point_2 &q, double min_x, double min_y, double max_x, double max_y, Point_2 &a, Point_2 &b)
+{
+    double x0 = CGAL::to_double(p.x()), y0 = CGAL::to_double(p.y());
+    double dx = CGAL::to_double(q.x()) - x0, dy = CGAL::to_double(q.y()) - y0;
+    double t0 = 0, t1 = 1;
+    double sides[4][2] = {{-dx, x0 - min_x}, {dx, max_x - x0}, {-dy, y0 - min_y}, {dy, max_y - y0}};
+    for (const auto &side : sides)
+    {
+        if (side[0] == 0)
+        {
+            if (side[1] < 0)
+                return false; // Parallel to this side and outside it
+            continue;
+        }
+        double t = side[1] / side[0];
+        if (side[0] < 0)
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+    }
+    if (t0 >= t1)
+        return false;
+    a = t0 == 0 ? p : Point_2(x0 + t0 * dx, y0 + t0 * dy);
+    b = t1 == 1 ? q : Point_2(x0 + t1 * dx, y0 + t1 * dy);
+    return true;
+}
+
+// Domain decomposition: the bounding box of the mesh is cut into a grid of tiles that are
+// refined in parallel, each with the seams held fixed. The Steiner points of all tiles are then
+// stitched into the global CDT and a last worklist pass repairs the faces along the seams.
+void tiled_refinement(CDT &cdt, const vector<pair<Point_2, Point_2>> &constraints, const region_index &region, mesh_score &score, vertex_index &index,
+                      ptree parameters, std::chrono::steady_clock::time_point deadline, checkpoint_writer *checkpoint)
+{
+    int threads = thread_parameter(parameters, "threads");
+    int no_tiles = parameters.get<int>("tiles", 0); // 0 = one tile per thread
+    if (no_tiles <= 0)
+        no_tiles = threads;
+    double margin = parameters.get<double>("margin", 0.1); // Halo width as a fraction of the tile size
+    int L = parameters.get<int>("L", 1000);
+
+    if (cdt.number_of_vertices() < 3)
+    {
+        task_pool pool(thread_parameter(parameters, "candidate_threads"));
+        refine_local(cdt, constraints, region, score, index, pool, L, deadline, checkpoint);
+        return;
+    }
+
+    double min_x = std::numeric_limits<double>::max(), min_y = min_x;
+    double max_x = std::numeric_limits<double>::lowest(), max_y = max_x;
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+    {
+        min_x = std::min(min_x, CGAL::to_double(vit->point().x()));
+        max_x = std::max(max_x, CGAL::to_double(vit->point().x()));
+        min_y = std::min(min_y, CGAL::to_double(vit->point().y()));
+        max_y = std::max(max_y, CGAL::to_double(vit->point().y()));
+    }
+
+    int columns = (int)std::ceil(std::sqrt((double)no_tiles));
+    int rows = (no_tiles + columns - 1) / columns;
+    double tile_width = (max_x - min_x) / columns, tile_height = (max_y - min_y) / rows;
+
+    // The outer sides of the border tiles are pushed out a little so that the points on the
+    // bounding box are not cut off by the open clip box
+    vector<refinement_tile> tiles(columns * rows);
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < columns; c++)
+        {
+            refinement_tile &tile = tiles[r * columns + c];
+            tile.min_x = c == 0 ? min_x - tile_width : min_x + c * tile_width;
+            tile.max_x = c == columns - 1 ? max_x + tile_width : min_x + (c + 1) * tile_width;
+            tile.min_y = r == 0 ? min_y - tile_height : min_y + r * tile_height;
+            tile.max_y = r == rows - 1 ? max_y + tile_height : min_y + (r + 1) * tile_height;
+        }
+    }
+
+    // Copy the input of every tile here, the workers never touch the global CDT
+    double halo_x = margin * tile_width, halo_y = margin * tile_height;
+    for (auto &tile : tiles)
+    {
+        double hx0 = tile.min_x - halo_x, hy0 = tile.min_y - halo_y, hx1 = tile.max_x + halo_x, hy1 = tile.max_y + halo_y;
+        for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); vit++)
+        {
+            if (in_box(vit->point(), hx0, hy0, hx1, hy1))
+                tile.vertices.push_back({vit->point(), vit->info()});
+        }
+        // A constraint that leaves the halo is cut at its side, so the faces along it keep the shape they
+        // have in the global CDT. The cut points are vertices of the tile only (info -2, not Steiner points).
+        for (const auto &constraint : constraints)
+        {
+            Point_2 a, b;
+            if (!clip_segment(constraint.first, constraint.second, hx0, hy0, hx1, hy1, a, b))
+                continue;
+            if (a != constraint.first)
+                tile.vertices.push_back({a, -2});
+            if (b != constraint.second)
+                tile.vertices.push_back({b, -2});
+            tile.constraints.push_back({a, b});
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int tile_budget = std::max(1, L / (int)tiles.size());
+    task_pool pool(std::min<int>(threads, tiles.size()));
+    pool.run(tiles.size(), [&](int t)
+             { refine_tile(tiles[t], region, tile_budget, deadline); });
+
+    // The mesh before stitching is the first candidate of the repair pass: if the stitched points
+    // make it worse and the repair cannot make up for it, the run falls back to it
+    best_solution best;
+    best.start(score);
+
+    // Stitch: the tiles never share a point, duplicates can only be vertices that already exist
+    int stitched = 0;
+    for (const auto &tile : tiles)
+    {
+        for (const auto &point : tile.steiner_points)
+        {
+            if (stitched >= L)
+                break;
+            if (index.contains(point))
+                continue;
+            CDT::Vertex_handle vertex = cdt.insert(point);
+            vertex->info() = -1; // Steiner point
+            index.insert(vertex);
+            best.record(vertex);
+            stitched++;
+        }
+    }
+    score.rebuild(cdt);
+    best.offer(score);
+    profile_count(COUNTER_STEINER_POINTS, stitched);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Tiled refinement: " << stitched << " Steiner points from " << tiles.size() << " tiles on " << pool.size()
+             << " threads in " << seconds << " s, penalty score after stitching: " << score.penalty());
+
+    // Repair: only the faces near a seam were never refined in their global shape, the tiles cut them off or
+    // refined them against a halo. So the worklist starts with the obtuse faces that reach into the halo of a
+    // seam line, the rest of the mesh is what the tiles left.
+    obtuse_worklist seams;
+    for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); face_it++)
+    {
+        double fx0 = std::numeric_limits<double>::max(), fy0 = fx0, fx1 = std::numeric_limits<double>::lowest(), fy1 = fx1;
+        for (int i = 0; i < 3; i++)
+        {
+            fx0 = std::min(fx0, CGAL::to_double(face_it->vertex(i)->point().x()));
+            fx1 = std::max(fx1, CGAL::to_double(face_it->vertex(i)->point().x()));
+            fy0 = std::min(fy0, CGAL::to_double(face_it->vertex(i)->point().y()));
+            fy1 = std::max(fy1, CGAL::to_double(face_it->vertex(i)->point().y()));
+        }
+        bool near_seam = false;
+        for (int c = 1; c < columns && !near_seam; c++)
+        {
+            double seam = min_x + c * tile_width;
+            near_seam = fx0 <= seam + halo_x && fx1 >= seam - halo_x;
+        }
+        for (int r = 1; r < rows && !near_seam; r++)
+        {
+            double seam = min_y + r * tile_height;
+            near_seam = fy0 <= seam + halo_y && fy1 >= seam - halo_y;
+        }
+        if (near_seam)
+            seams.push_face(cdt, face_it);
+    }
+    LOG_INFO("Tiled refinement: " << seams.size() << " obtuse faces near the seams to repair");
+
+    task_pool repair_pool(thread_parameter(parameters, "candidate_threads"));
+    refine_local(cdt, constraints, region, score, index, repair_pool, L - stitched, deadline, checkpoint, &best, &seams);
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "./func.h"
+#include <iostream>
+
+cdt_transaction::cdt_transaction(CDT &cdt, mesh_score *score, vertex_index *index) : cdt(cdt), score(score), index(index)
+{
+}
+
+void cdt_transaction::begin()
+{
+    undo_log.clear();
+    open = true;
+}
+
+void cdt_transaction::commit()
+{
+    undo_log.clear();
+    open = false;
+}
+
+// Undo every recorded change, newest first
+void cdt_transaction::rollback()
+{
+    bool exact = true;
+    while (!undo_log.empty())
+    {
+        undo_record record = undo_log.back();
+        undo_log.pop_back();
+        if (record.is_flip)
+            exact = undo_flip(record) && exact;
+        else
+            exact = undo_insert(record) && exact;
+    }
+    open = false;
+
+    // The old faces could not be rebuilt exactly, the score has to be recounted
+    if (!exact && score != nullptr)
+        score->rebuild(cdt);
+}
+
+// Flip the edge (face, i) if the quadrilateral around it is convex
+bool cdt_transaction::flip(CDT::Face_handle face, int i)
+{
+    if (cdt.is_infinite(face) || cdt.is_infinite(face->neighbor(i)) || cdt.is_constrained(CDT::Edge(face, i)))
+        return false;
+    if (!is_flippable(face, i))
+        return false;
+
+    CDT::Face_handle neighbour = face->neighbor(i);
+    undo_record record;
+    record.is_flip = true;
+    record.a = face->vertex(i);
+    record.b = neighbour->vertex(cdt.mirror_index(face, i));
+
+    if (score != nullptr)
+    {
+        score->remove_face(score_face(face));
+        score->remove_face(score_face(neighbour));
+    }
+
+    cdt.flip(face, i);
+
+    if (score != nullptr)
+        add_faces_of_edge(record.a, record.b);
+
+    if (open)
+        undo_log.push_back(record);
+    return true;
+}
+
+// Insert point and remember the faces it destroys so that they can be rebuilt
+CDT::Vertex_handle cdt_transaction::insert(const Point_2 &point)
+{
+    vector<CDT::Face_handle> zone;
+    vector<CDT::Edge> boundary;
+    if (!get_conflict_zone(cdt, point, zone, boundary))
+        return CDT::Vertex_handle(); // Duplicate point or a CDT without faces yet
+
+    undo_record record;
+    record.is_flip = false;
+    for (const auto &face : zone)
+    {
+        if (cdt.is_infinite(face))
+            continue;
+        record.old_faces.push_back({face->vertex(0), face->vertex(1), face->vertex(2)});
+        if (score != nullptr)
+            score->remove_face(score_face(face));
+    }
+
+    record.vertex = cdt.insert(point);
+    record.vertex->info() = -1; // Steiner point
+    if (index != nullptr)
+        index->insert(record.vertex);
+
+    if (score != nullptr)
+    {
+        CDT::Face_circulator fc = cdt.incident_faces(record.vertex), done = fc;
+        do
+        {
+            if (!cdt.is_infinite(fc))
+                score->add_face(score_face(fc));
+        } while (++fc != done);
+    }
+
+    // A point on a constrained edge splits it in two, the constraint hierarchy records the
+    // new vertex in that constraint so nothing has to be remembered here
+    if (open)
+        undo_log.push_back(record);
+    return record.vertex;
+}
+
+bool cdt_transaction::undo_flip(const undo_record &record)
+{
+    CDT::Face_handle face;
+    int i;
+    if (!cdt.is_edge(record.a, record.b, face, i))
+        return false;
+
+    if (score != nullptr)
+    {
+        score->remove_face(score_face(face));
+        score->remove_face(score_face(face->neighbor(i)));
+    }
+
+    // Flipping the new diagonal brings back the old one
+    CDT::Vertex_handle c = face->vertex(cdt.ccw(i));
+    CDT::Vertex_handle d = face->vertex(cdt.cw(i));
+    cdt.flip(face, i);
+
+    if (score != nullptr)
+        add_faces_of_edge(c, d);
+    return true;
+}
+
+bool cdt_transaction::undo_insert(const undo_record &record)
+{
+    if (score != nullptr)
+    {
+        CDT::Face_circulator fc = cdt.incident_faces(record.vertex), done = fc;
+        do
+        {
+            if (!cdt.is_infinite(fc))
+                score->remove_face(score_face(fc));
+        } while (++fc != done);
+    }
+
+    // Removing the vertex re-triangulates the hole, then the old faces are flipped back in
+    if (index != nullptr)
+        index->remove(record.vertex->point());
+    remove_steiner_point(cdt, record.vertex);
+
+    bool exact = true;
+    for (const auto &face : record.old_faces)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            if (!force_edge(face[i], face[(i + 1) % 3]))
+                exact = false;
+        }
+    }
+
+    if (score != nullptr && exact)
+    {
+        for (const auto &face : record.old_faces)
+            score->add_face(score_face(face[0]->point(), face[1]->point(), face[2]->point()));
+    }
+    return exact;
+}
+
+// Flip edges crossing the segment a-b until a-b is an edge of the CDT.
+// A triangulation always has a convex quadrilateral among the crossed edges,
+// the guard only protects against degenerate (collinear) input.
+bool cdt_transaction::force_edge(CDT::Vertex_handle a, CDT::Vertex_handle b)
+{
+    for (int guard = 0; guard < 256; guard++)
+    {
+        if (cdt.is_edge(a, b))
+            return true;
+
+        CDT::Face_handle face;
+        int i;
+        if (!first_crossing(a, b, face, i))
+            return false;
+
+        // Walk along a-b and flip the first crossed edge that can be flipped
+        bool flipped = false;
+        while (!flipped)
+        {
+            if (cdt.is_constrained(CDT::Edge(face, i)))
+                return false;
+            if (is_flippable(face, i))
+            {
+                cdt.flip(face, i);
+                flipped = true;
+                break;
+            }
+
+            CDT::Face_handle next = face->neighbor(i);
+            CDT::Vertex_handle c = face->vertex(cdt.ccw(i)); // Right of a-b
+            CDT::Vertex_handle d = face->vertex(cdt.cw(i));  // Left of a-b
+            CDT::Vertex_handle e = next->vertex(cdt.mirror_index(face, i));
+            if (e == b || cdt.is_infinite(e))
+                return false;
+
+            CGAL::Orientation side = CGAL::orientation(a->point(), b->point(), e->point());
+            if (side == CGAL::COLLINEAR)
+                return false;
+            face = next;
+            i = side == CGAL::LEFT_TURN ? next->index(d) : next->index(c);
+        }
+    }
+    return cdt.is_edge(a, b);
+}
+
+// Face around a through which the segment a-b leaves a, i is the index of a in it
+bool cdt_transaction::first_crossing(CDT::Vertex_handle a, CDT::Vertex_handle b, CDT::Face_handle &face, int &i)
+{
+    CDT::Face_circulator fc = cdt.incident_faces(a), done = fc;
+    do
+    {
+        if (cdt.is_infinite(fc))
+            continue;
+        int ia = fc->index(a);
+        const Point_2 &c = fc->vertex(cdt.ccw(ia))->point();
+        const Point_2 &d = fc->vertex(cdt.cw(ia))->point();
+        if (CGAL::orientation(a->point(), c, b->point()) == CGAL::LEFT_TURN &&
+            CGAL::orientation(a->point(), d, b->point()) == CGAL::RIGHT_TURN)
+        {
+            face = fc;
+            i = ia;
+            return true;
+        }
+    } while (++fc != done);
+    return false;
+}
+
+// An edge can be flipped only if the two faces around it form a convex quadrilateral
+bool cdt_transaction::is_flippable(CDT::Face_handle face, int i) const
+{
+    CDT::Face_handle neighbour = face->neighbor(i);
+    if (cdt.is_infinite(face) || cdt.is_infinite(neighbour))
+        return false;
+
+    const Point_2 &p = face->vertex(i)->point();
+    const Point_2 &q = face->vertex(cdt.ccw(i))->point();
+    const Point_2 &r = neighbour->vertex(cdt.mirror_index(face, i))->point();
+    const Point_2 &s = face->vertex(cdt.cw(i))->point();
+    return CGAL::orientation(p, q, r) == CGAL::LEFT_TURN && CGAL::orientation(p, r, s) == CGAL::LEFT_TURN;
+}
+
+void cdt_transaction::add_faces_of_edge(CDT::Vertex_handle a, CDT::Vertex_handle b)
+{
+    CDT::Face_handle face;
+    int i;
+    if (!cdt.is_edge(a, b, face, i))
+        return;
+    if (!cdt.is_infinite(face))
+        score->add_face(score_face(face));
+    if (!cdt.is_infinite(face->neighbor(i)))
+        score->add_face(score_face(face->neighbor(i)));
+}
+// Remove a Steiner point. A vertex that split a constraint is in the vertex list of that constraint,
+// the constraints through it are taken out and put back without it once the vertex is gone. Each one
+// goes back as a single polyline, so the hierarchy still has the input constraint from end to end.
+void remove_steiner_point(CDT &cdt, CDT::Vertex_handle vertex)
+{
+    vector<vector<Point_2>> split_constraints;
+    while (cdt.are_there_incident_constraints(vertex))
+    {
+        CDT::Vertex_handle other;
+        CDT::Edge_circulator ec = cdt.incident_edges(vertex), done = ec;
+        do
+        {
+            if (cdt.is_constrained(*ec))
+            {
+                other = ec->first->vertex(cdt.ccw(ec->second)) == vertex ? ec->first->vertex(cdt.cw(ec->second))
+                                                                         : ec->first->vertex(cdt.ccw(ec->second));
+                break;
+            }
+        } while (++ec != done);
+
+        CDT::Constraint_id constraint = cdt.context(vertex, other).id();
+        vector<Point_2> polyline;
+        for (auto vit = cdt.vertices_in_constraint_begin(constraint); vit != cdt.vertices_in_constraint_end(constraint); ++vit)
+        {
+            if (*vit != vertex)
+                polyline.push_back((*vit)->point());
+        }
+        cdt.remove_constraint(constraint);
+        split_constraints.push_back(polyline);
+    }
+    cdt.remove(vertex);
+    // Every point of the chain is still a vertex, the insertion only finds it again
+    for (const auto &polyline : split_constraints)
+        cdt.insert_constraint(polyline.begin(), polyline.end());
+}
\ No newline at end of file
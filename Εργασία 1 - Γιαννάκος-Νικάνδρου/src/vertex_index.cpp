@@ -0,0 +1,50 @@
+#include "./func.h"
+#include <iostream>
+
+// -0.0 and 0.0 compare equal, so they must also hash the same
+size_t vertex_index::point_hash::operator()(const Point_2 &p) const
+{
+    double x = CGAL::to_double(p.x()) + 0.0;
+    double y = CGAL::to_double(p.y()) + 0.0;
+    size_t h = std::hash<double>()(x);
+    return h ^ (std::hash<double>()(y) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+// Index every finite vertex of the CDT, used once after the input points are inserted
+void vertex_index::rebuild(const CDT &cdt)
+{
+    vertices.clear();
+    vertices.reserve(cdt.number_of_vertices());
+    for (CDT::Finite_vertices_iterator vit = cdt.finite_vertices_begin(); vit != cdt.finite_vertices_end(); ++vit)
+        vertices[vit->point()] = vit;
+}
+
+void vertex_index::insert(CDT::Vertex_handle vertex)
+{
+    if (vertex != CDT::Vertex_handle())
+        vertices[vertex->point()] = vertex;
+}
+
+void vertex_index::remove(const Point_2 &point)
+{
+    vertices.erase(point);
+}
+
+// Vertex at exactly this point, or a null handle
+CDT::Vertex_handle vertex_index::find(const Point_2 &point) const
+{
+    auto it = vertices.find(point);
+    return it == vertices.end() ? CDT::Vertex_handle() : it->second;
+}
+
+// Duplicate test for Steiner candidates, O(1) expected
+bool vertex_index::contains(const Point_2 &point)
+{
+    if (vertices.count(point) > 0)
+    {
+        hits++;
+        return true;
+    }
+    misses++;
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "./func.h"
+#include <iostream>
+
+// Queue the face if it is obtuse, returns true if it was queued
+bool obtuse_worklist::push_face(const CDT &cdt, CDT::Face_handle face)
+{
+    if (cdt.is_infinite(face))
+        return false;
+
+    faces_examined++;
+
+    Point_2 p[3] = {face->vertex(0)->point(), face->vertex(1)->point(), face->vertex(2)->point()};
+    int worst = obtuse_vertex(p[0], p[1], p[2]);
+    if (worst < 0)
+        return false;
+
+    // Degenerate faces (angle = 0) are skipped like in the full scan
+    if (is_degenerate_triangle(p[0], p[1], p[2]))
+        return false;
+
+    obtuse_face entry;
+    entry.worst_cosine = angle_cosine(p[worst], p[(worst + 1) % 3], p[(worst + 2) % 3]);
+    for (int i = 0; i < 3; i++)
+        entry.vertices[i] = face->vertex(i);
+    entry.obtuse_vertex = face->vertex(worst);
+    queue.push(entry);
+    return true;
+}
+
+// Queue every obtuse face of the CDT, the faces are classified in one batch
+int obtuse_worklist::push_all_faces(const CDT &cdt)
+{
+    vector<CDT::Face_handle> faces;
+    triangle_batch batch;
+    faces.reserve(cdt.number_of_faces());
+    batch.reserve(cdt.number_of_faces());
+    for (CDT::Finite_faces_iterator face_it = cdt.finite_faces_begin(); face_it != cdt.finite_faces_end(); face_it++)
+    {
+        faces.push_back(face_it);
+        batch.push_back(face_it->vertex(0)->point(), face_it->vertex(1)->point(), face_it->vertex(2)->point());
+    }
+
+    vector<int8_t> obtuse;
+    classify_obtuse_batch(batch, obtuse);
+
+    int queued = 0;
+    for (size_t i = 0; i < faces.size(); i++)
+    {
+        if (obtuse[i] >= 0 && push_face(cdt, faces[i]))
+            queued++;
+    }
+    faces_examined = faces.size();
+    return queued;
+}
+
+// Queue the faces around a newly inserted vertex, these are the only faces an insertion creates
+int obtuse_worklist::push_incident_faces(const CDT &cdt, CDT::Vertex_handle vertex)
+{
+    int queued = 0;
+    CDT::Face_circulator fc = cdt.incident_faces(vertex), done = fc;
+    if (fc == nullptr)
+        return 0;
+    do
+    {
+        if (push_face(cdt, fc))
+            queued++;
+    } while (++fc != done);
+    return queued;
+}
+
+// Pop the worst obtuse face that still exists in the CDT.
+// Faces destroyed by earlier insertions are dropped lazily here.
+bool obtuse_worklist::pop(const CDT &cdt, CDT::Face_handle &face, int &obtuse_index)
+{
+    while (!queue.empty())
+    {
+        obtuse_face entry = queue.top();
+        queue.pop();
+        faces_examined++;
+
+        if (cdt.is_face(entry.vertices[0], entry.vertices[1], entry.vertices[2], face))
+        {
+            obtuse_index = face->index(entry.obtuse_vertex);
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file